@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 
 #include <string>
 
@@ -11,6 +15,16 @@
 #include <OgreRenderWindow.h>
 #include <OgreException.h>
 #include <OgreEntity.h>
+#include <OgreTextureManager.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreRenderTexture.h>
+#include <OgreWindowEventUtilities.h>
+
+#ifdef OGRE_STATIC_PLUGINS
+#include <OgreGLPlugin.h>
+#include <OgreParticleFXPlugin.h>
+#include <OgreOctreePlugin.h>
+#endif
 
 #include <OISInputManager.h>
 
@@ -36,16 +50,204 @@ const OIS::ParamList Application::oisdefault = {
   {"w32_keyboard", "DISCL_NONEXCLUSIVE"},
 };
 
+Application::options::options() {
+}
+
+Application::options::options(int ac, char* av[]) {
+  for(int i = 1; i < ac; ++i) {
+    const bool has_value = i + 1 < ac;
+    if(0 == std::strcmp(av[i], "--headless"))
+      m_headless = true;
+    else if(0 == std::strcmp(av[i], "--size")) {
+      if(!has_value || 2 != std::sscanf(av[++i], "%ux%u", &m_width, &m_height) || 0 == m_width || 0 == m_height)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+          "--size expects <width>x<height>", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--frames")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_frames))
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--frames expects a number", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--frame-stats")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--frame-stats expects a file name", __FILE__);
+      m_frame_stats = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--input-thread"))
+      m_input_thread = true;
+    else if(0 == std::strcmp(av[i], "--sim-rate")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%lf", &m_simulation_rate) || m_simulation_rate <= 0.0)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--sim-rate expects steps per second", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--sim-max-steps")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_simulation_max_steps) || 0 == m_simulation_max_steps)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--sim-max-steps expects a positive number", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--on-demand"))
+      m_on_demand = true;
+    else if(0 == std::strcmp(av[i], "--frame-cap")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%lf", &m_frame_cap) || m_frame_cap < 0.0)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--frame-cap expects frames per second", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--resource-index")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--resource-index expects a file name or off", __FILE__);
+      m_resource_index = av[++i];
+      if("off" == m_resource_index)
+        m_resource_index.clear();
+    }
+    else if(0 == std::strcmp(av[i], "--startup-report")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--startup-report expects a file name", __FILE__);
+      m_startup_report = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--startup-budget")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--startup-budget expects a budget file", __FILE__);
+      m_startup_budget = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--render-system")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--render-system expects a render system name", __FILE__);
+      m_render_system = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--render-benchmark"))
+      m_render_benchmark = true;
+    else if(0 == std::strcmp(av[i], "--render-cache")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--render-cache expects a file name", __FILE__);
+      m_render_cache = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--vsync"))
+      m_vsync = true;
+    else if(0 == std::strcmp(av[i], "--fsaa")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_fsaa))
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--fsaa expects a sample count", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--wheel-segments")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_wheel_segments) || m_wheel_segments < 3)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--wheel-segments expects at least 3", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--mesh-cache")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--mesh-cache expects a directory or off", __FILE__);
+      m_mesh_cache = av[++i];
+      if("off" == m_mesh_cache)
+        m_mesh_cache.clear();
+    }
+    else if(0 == std::strcmp(av[i], "--packed-vertices"))
+      m_packed_vertices = true;
+    else if(0 == std::strcmp(av[i], "--reels")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_reels) || 0 == m_reels)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--reels expects a reel count", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--instanced-reels"))
+      m_instanced_reels = true;
+    else if(0 == std::strcmp(av[i], "--reel-arc"))
+      m_reel_arc = true;
+    else if(0 == std::strcmp(av[i], "--raycast-reels")) {
+      if(has_value)
+        m_raycast_reels = av[++i];
+      if("all" != m_raycast_reels && "columns" != m_raycast_reels)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--raycast-reels expects all or columns", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--virtual-strip")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%u", &m_virtual_strip) || 0 == m_virtual_strip)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--virtual-strip expects a symbol count", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--symbol-atlas"))
+      m_symbol_atlas = true;
+    else if(0 == std::strcmp(av[i], "--trace")) {
+      if(!has_value)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--trace expects a file name", __FILE__);
+      m_trace = av[++i];
+    }
+    else if(0 == std::strcmp(av[i], "--hitch-budget")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%lf", &m_hitch_budget) || m_hitch_budget <= 0.0)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--hitch-budget expects milliseconds", __FILE__);
+    }
+    else if(0 == std::strcmp(av[i], "--hitch-window")) {
+      if(!has_value || 1 != std::sscanf(av[++i], "%lf", &m_hitch_window) || m_hitch_window <= 0.0)
+        throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "--hitch-window expects seconds", __FILE__);
+    }
+    else
+      throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+        Ogre::String("unknown option: ") + av[i], __FILE__);
+  }
+  if((m_instanced_reels || m_reel_arc) && m_packed_vertices)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "--instanced-reels and --reel-arc draw the float vertex layout only", __FILE__);
+  if(!m_raycast_reels.empty() && (m_instanced_reels || m_packed_vertices))
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "--raycast-reels draws one entity per reel with the float vertex layout", __FILE__);
+  if(0 != m_virtual_strip && (m_instanced_reels || m_packed_vertices || !m_raycast_reels.empty()))
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "--virtual-strip draws one float reel arc entity per reel", __FILE__);
+  if(m_symbol_atlas && (m_reel_arc || !m_raycast_reels.empty()))
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "--reel-arc and --raycast-reels scroll a whole strip texture, --symbol-atlas has none", __FILE__);
+}
+
+Application::input_event::input_event(const type value, const OIS::KeyEvent& key)
+    : m_type(value)
+    , m_time(std::chrono::steady_clock::now())
+    , m_key(key.key)
+    , m_text(key.text) {
+}
+
+Application::input_event::input_event(const type value, const OIS::MouseEvent& mouse,
+      const OIS::MouseButtonID button)
+    : m_type(value)
+    , m_time(std::chrono::steady_clock::now())
+    , m_state(mouse.state)
+    , m_button(button) {
+}
+
 Application::Application(const Ogre::String& plugin_config,
-      const Ogre::String& resource_config)
-    : m_plugin_config(plugin_config)
+      const Ogre::String& resource_config, const options& value)
+    : m_options(value)
+    , m_plugin_config(plugin_config)
     , m_resource_config(resource_config)
-    , m_root(new Ogre::Root(m_plugin_config))
-    , m_input_manager(0, &OIS::InputManager::destroyInputSystem) {
-  loadPlugins();
-  setRenderSystem();
-  initializeRenderSystem();
-  createRenderWindow();
+    , m_root(new Ogre::Root(""))
+    , m_input_manager(0, &OIS::InputManager::destroyInputSystem)
+    , m_render_system_selector(m_options.m_render_cache, m_options.m_render_benchmark)
+    , m_frame_stats(m_options.m_frame_stats.empty() ? 0 : new frame_stats())
+    , m_simulation_step(1.0 / m_options.m_simulation_rate) {
+  if(!m_options.m_trace.empty() || m_options.m_hitch_budget > 0.0) {
+    tracer::enable();
+    tracer::set_thread_name("render");
+  }
+  if(m_options.m_hitch_budget > 0.0)
+    m_hitch_detector.reset(new hitch_detector(
+      std::chrono::duration_cast<tracer::clock_t::duration>(std::chrono::duration<double, std::milli>(m_options.m_hitch_budget)),
+      std::chrono::duration_cast<tracer::clock_t::duration>(std::chrono::duration<double>(m_options.m_hitch_window)),
+      m_options.m_trace.empty() ? Ogre::String("hitch") : m_options.m_trace + "-hitch"));
+  if(!m_options.m_mesh_cache.empty())
+    m_mesh_cache.reset(new mesh_cache(m_options.m_mesh_cache));
+  m_startup.add("phase", "Ogre::Root", m_startup.start(), startup_profile::clock_t::now());
+  TRACE_ZONE("Application::Application");
+  {
+    TRACE_ZONE("loadPlugins");
+    startup_profile::scope phase(m_startup, "phase", "loadPlugins");
+    loadPlugins();
+  }
+  {
+    TRACE_ZONE("setRenderSystem");
+    startup_profile::scope phase(m_startup, "phase", "setRenderSystem");
+    setRenderSystem();
+  }
+  {
+    TRACE_ZONE("initializeRenderSystem");
+    startup_profile::scope phase(m_startup, "phase", "initializeRenderSystem");
+    initializeRenderSystem();
+  }
+  {
+    TRACE_ZONE("createRenderWindow");
+    startup_profile::scope phase(m_startup, "phase", "createRenderWindow");
+    if(m_options.m_headless)
+      createOffscreenTarget(m_options.m_width, m_options.m_height);
+    else
+      createRenderWindow("Application", 800, 600, false, &m_window_params);
+  }
 }
 
 Application::~Application() {
@@ -54,35 +256,74 @@ Application::~Application() {
 
 void Application::startApplication()
 {
-  parseResourceFileConfiguration();
-  initializeResources();
-  createScene();
+  {
+    TRACE_ZONE("parseResourceFileConfiguration");
+    startup_profile::scope phase(m_startup, "phase", "parseResourceFileConfiguration");
+    parseResourceFileConfiguration();
+  }
+  {
+    TRACE_ZONE("initializeResources");
+    startup_profile::scope phase(m_startup, "phase", "initializeResources");
+    initializeResources();
+  }
+  {
+    TRACE_ZONE("createScene");
+    startup_profile::scope phase(m_startup, "phase", "createScene");
+    createScene();
+  }
   m_root->addFrameListener(this);
-  m_root->startRendering();
+  m_frame_start = stamp();
+  m_render_start = startup_profile::clock_t::now();
+  if(m_options.m_headless)
+    render_frames(m_options.m_frames);
+  else if(m_options.m_on_demand || m_options.m_frame_cap > 0.0)
+    render_loop();
+  else
+    m_root->startRendering();
   m_root->removeFrameListener(this);
-
+  if(!m_startup_error.empty())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALID_STATE, m_startup_error, __FILE__);
+  if(m_frame_stats)
+    write_frame_stats();
+  if(!m_options.m_trace.empty())
+    write_trace();
 }
 
 void Application::loadPlugins()
 {
-#if 0
-    // Set the render system. In this case OpenGL
-    Ogre::GLPlugin* gLPlugin = new Ogre::GLPlugin();
-    root->installPlugin( gLPlugin );
-    Ogre::ParticleFXPlugin *particleFXPlugin = new Ogre::ParticleFXPlugin();
-    root->installPlugin( particleFXPlugin );
-#endif    
+#ifdef OGRE_STATIC_PLUGINS
+  // only what the game uses, octree keeps ST_GENERIC on the same scene manager as the dynamic build
+  install_plugin("RenderSystem_GL", new Ogre::GLPlugin());
+  install_plugin("Plugin_ParticleFX", new Ogre::ParticleFXPlugin());
+  install_plugin("Plugin_OctreeSceneManager", new Ogre::OctreePlugin());
+#else
+  // Ogre::Root is created without the plugin config so each load can be timed
+  Ogre::ConfigFile config;
+  config.load(m_plugin_config);
+  Ogre::String folder = config.getSetting("PluginFolder");
+  if(folder.empty())
+    folder = ".";
+  for(const Ogre::String& name : config.getMultiSetting("Plugin")) {
+    startup_profile::scope plugin(m_startup, "plugin", name);
+    m_root->loadPlugin(folder + "/" + name);
+  }
+#endif
+}
+
+void Application::install_plugin(const Ogre::String& name, Ogre::Plugin* value) {
+  startup_profile::scope plugin(m_startup, "plugin", name);
+  m_static_plugins.emplace_back(value);
+  m_root->installPlugin(value);
 }
 
 void Application::setRenderSystem()
 {
-  const Ogre::RenderSystemList &renderSystemList = m_root->getAvailableRenderers();
-  if( renderSystemList.size() == 0 )
-    throw Ogre::Exception(Ogre::Exception::ERR_RENDERINGAPI_ERROR, "Sorry, no rendersystem was found.", __FILE__);
-  Ogre::RenderSystem *lRenderSystem = renderSystemList[ 0 ];
+  Ogre::RenderSystem* lRenderSystem = m_render_system_selector.select(m_root->getAvailableRenderers(),
+    m_options.m_render_system);
   Ogre::String renderSystemName = lRenderSystem->getName();
   Ogre::LogManager::getSingleton().logMessage( "Render System found: " + renderSystemName, Ogre::LML_NORMAL );
   m_root->setRenderSystem( lRenderSystem );
+  m_window_params = m_render_system_selector.recommended(defparam, m_options.m_vsync, m_options.m_fsaa);
 }
 
 void Application::initializeRenderSystem()
@@ -98,55 +339,166 @@ void Application::createRenderWindow(const Ogre::String title,
       const bool full_screen, const Ogre::NameValuePairList* params)
 {
   m_renderWindow = m_root->createRenderWindow( title, width, height, full_screen, params);
+  m_render_target = m_renderWindow;
+}
+
+void Application::createOffscreenTarget(const unsigned int width, const unsigned int height)
+{
+  // GL still needs a window to own the context, keep it hidden and out of the frame loop.
+  Ogre::NameValuePairList params(m_window_params);
+  params["hidden"] = "true";
+  createRenderWindow("Offscreen", 1, 1, false, &params);
+  m_renderWindow->setAutoUpdated(false);
+  Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().createManual("Application/Offscreen",
+    Ogre::ResourceGroupManager::INTERNAL_RESOURCE_GROUP_NAME, Ogre::TEX_TYPE_2D, width, height, 0,
+    Ogre::PF_X8R8G8B8, Ogre::TU_RENDERTARGET);
+  m_render_target = texture->getBuffer()->getRenderTarget();
+  m_render_target->setAutoUpdated(true);
+  Ogre::LogManager::getSingleton().logMessage("Headless rendering into " +
+    Ogre::StringConverter::toString(width) + "x" + Ogre::StringConverter::toString(height) +
+    " offscreen target", Ogre::LML_NORMAL);
 }
 
 void Application::initializeResources()
 {
     // Set default mipmap level (note: some APIs ignore this)
     Ogre::TextureManager::getSingleton().setDefaultNumMipmaps( 5 );
-    Ogre::ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+    m_resource_groups->initialise_eager();
+}
+
+void Application::require_resource_group(const Ogre::String& value) {
+  m_resource_groups->require(value);
+}
+
+void Application::prefetch_resource_group(const Ogre::String& value) {
+  m_resource_groups->prefetch(value);
+}
+
+resource_groups::progress_event_t& Application::get_resource_progress() {
+  return m_resource_groups->get_progress();
+}
+
+// Either way the time spent shows up as mesh/<name> in the startup report.
+Ogre::MeshPtr Application::cached_mesh(const mesh_key& key, const mesh_cache::generator_t& generate) {
+  startup_profile::scope entry(m_startup, "mesh", key.name());
+  if(!m_mesh_cache)
+    return generate();
+  return m_mesh_cache->get(key, generate);
 }
 
 void Application::start_input(OIS::ParamList value) {
+  if(m_options.m_headless)
+    return;
   static const char* name_win = "WINDOW";
   std::size_t handle;
   get_render_window()->getCustomAttribute(name_win, &handle);
   value.insert({name_win, std::to_string(handle)});
   m_input_manager = std::move(input_manager_ptr(OIS::InputManager::createInputSystem(value),
     &OIS::InputManager::destroyInputSystem));
+  if(0 != (m_input_context.mKeyboard = static_cast<OIS::Keyboard*>(m_input_manager->createInputObject(OIS::OISKeyboard, true))))
+    m_input_context.mKeyboard->setEventCallback(this);
+  if(0 != (m_input_context.mMouse = static_cast<OIS::Mouse*>(m_input_manager->createInputObject(OIS::OISMouse, true)))) {
+    windowResized();
+    m_input_context.mMouse->setEventCallback(this);
+  }
+  if(m_options.m_input_thread) {
+    m_input_threaded = true;
+    m_input_running = true;
+    m_input_thread = std::thread(&Application::input_loop, this);
+  }
 }
 
 void Application::stop_input() {
-  set_key_listener(key_listener_ptr());
-  set_mouse_listener(mouse_listener_ptr());
+  if(!m_input_manager)
+    return;
+  if(m_input_thread.joinable()) {
+    m_input_running = false;
+    m_input_thread.join();
+    m_input_threaded = false;
+    if(0 != m_input_dropped)
+      Ogre::LogManager::getSingleton().logMessage("Input queue overflow, events dropped: " +
+        Ogre::StringConverter::toString(m_input_dropped.load()), Ogre::LML_NORMAL);
+  }
+  if(0 != m_input_context.mKeyboard) {
+    m_input_context.mKeyboard->setEventCallback(0);
+    m_input_manager->destroyInputObject(m_input_context.mKeyboard);
+    m_input_context.mKeyboard = 0;
+  }
+  if(0 != m_input_context.mMouse) {
+    m_input_context.mMouse->setEventCallback(0);
+    m_input_manager->destroyInputObject(m_input_context.mMouse);
+    m_input_context.mMouse = 0;
+  }
   m_input_manager.reset();
 }
 
+Application::frame_listener& Application::get_frame_listener() {
+  return m_frame_listener;
+}
+
+Application::key_listener& Application::get_key_listener() {
+  return m_key_listener;
+}
+
+Application::mouse_listener& Application::get_mouse_listener() {
+  return m_mouse_listener;
+}
+
+std::chrono::steady_clock::time_point Application::input_time() const {
+  return m_input_time;
+}
+
+Application::simulation_listener& Application::get_simulation_listener() {
+  return m_simulation_listener;
+}
+
+double Application::simulation_step() const {
+  return m_simulation_step;
+}
+
+double Application::interpolation_alpha() const {
+  return m_alpha;
+}
+
+void Application::invalidate() {
+  m_dirty = true;
+}
+
+void Application::invalidate_at(const std::chrono::steady_clock::time_point& value) {
+  if(std::chrono::steady_clock::time_point() == m_redraw_at || value < m_redraw_at)
+    m_redraw_at = value;
+}
+
+void Application::set_animating(const bool value) {
+  if(value && !m_animating)
+    m_dirty = true;
+  m_animating = value;
+}
+
+void Application::watch_node(Ogre::Node* value) {
+  const watched_node node = {value, value->_getDerivedPosition(), value->_getDerivedOrientation(),
+    value->_getDerivedScale()};
+  m_watched_nodes.push_back(node);
+}
+
 void Application::parseResourceFileConfiguration()
 {
-    // set up resources and load resource paths from config file
-    Ogre::String resourcesConfigurationPath = m_resource_config;
-    Ogre::ConfigFile configurationFile;
-    configurationFile.load( resourcesConfigurationPath );
-
-    // Go through all sections & settings in the resource file
-    Ogre::ConfigFile::SectionIterator sectionNameIterator = configurationFile.getSectionIterator();
-    Ogre::String sectionNameOfTheResource;
+    // set up resources and load resource paths from config file, lazy groups
+    // are only registered here
+    if(!m_options.m_resource_index.empty()) {
+      m_resource_index.reset(new resource_index(m_options.m_resource_index));
+      m_resource_index->install();
+    }
+    m_resource_groups.reset(new resource_groups());
+    m_resource_groups->get_initialised().subscribe([&](const Ogre::String& name,
+        const resource_groups::clock_t::time_point& start, const resource_groups::clock_t::time_point& end) {
+      m_startup.add("resource_group", name, start, end);
+      return true;
+    });
+    m_resource_groups->parse(m_resource_config, m_resource_index.get());
     Ogre::String typeNameOfTheResource;
     Ogre::String absolutePathToTheResource;
-
-    while( sectionNameIterator.hasMoreElements() )
-    {
-        sectionNameOfTheResource = sectionNameIterator.peekNextKey();
-        Ogre::ConfigFile::SettingsMultiMap *settings = sectionNameIterator.getNext();
-        Ogre::ConfigFile::SettingsMultiMap::iterator i;
-        for( i = settings->begin(); i != settings->end(); ++i )
-        {
-            typeNameOfTheResource = i->first;
-            absolutePathToTheResource = i->second;
-            Ogre::ResourceGroupManager::getSingleton().addResourceLocation( absolutePathToTheResource, typeNameOfTheResource, sectionNameOfTheResource );
-        }
-    }
+    Ogre::String sectionNameOfTheResource;
 
     const Ogre::ResourceGroupManager::LocationList genLocs = Ogre::ResourceGroupManager::getSingleton().getResourceLocationList("General");
     absolutePathToTheResource = OGRE_HOME "/share/OGRE/Media";//"/opt/ogre-1.9/share/OGRE/Media";
@@ -203,6 +555,8 @@ void Application::parseResourceFileConfiguration()
     Ogre::ResourceGroupManager::getSingleton().addResourceLocation(absolutePathToTheResource + "/RTShaderLib/Cg", typeNameOfTheResource, sectionNameOfTheResource);
 #			endif
 #		endif // include_rtshader_system
+    if(m_resource_index)
+        m_resource_index->save();
 }
 
 void Application::createScene()
@@ -214,7 +568,7 @@ void Application::createScene()
   camera->setPosition(0, 0, 120);
   camera->setNearClipDistance( 5 );
 
-  Ogre::Viewport* viewPort = get_render_window()->addViewport( camera );
+  Ogre::Viewport* viewPort = get_render_target()->addViewport( camera );
   viewPort->setBackgroundColour( Ogre::ColourValue( 0, 0, 0 ) );
   camera->setAspectRatio( Ogre::Real( viewPort->getActualWidth() ) / Ogre::Real( viewPort->getActualHeight() ) );
 
@@ -237,94 +591,339 @@ Ogre::RenderWindow* Application::get_render_window() {
   return m_renderWindow;
 }
 
-void Application::set_frame_listener(frame_listener_ptr&& value) {
-  m_frame_listener = std::move(value);
+Ogre::RenderTarget* Application::get_render_target() {
+  return m_render_target;
 }
 
-void Application::set_key_listener(key_listener_ptr&& value) {
-  assert(static_cast<bool>(m_input_manager));
-  m_key_listner = std::move(value);  
-  if(static_cast<bool>(m_key_listner)) {
-    if(0 != (m_input_context.mKeyboard = static_cast<OIS::Keyboard*>(m_input_manager->createInputObject(OIS::OISKeyboard, true))))
-      m_input_context.mKeyboard->setEventCallback(this);
-  }
-  else if(0 != m_input_context.mKeyboard) {
-    m_input_context.mKeyboard->setEventCallback(0);  
-    m_input_manager->destroyInputObject(m_input_context.mKeyboard);
-    m_input_context.mKeyboard = 0;
-  }
+const Application::options& Application::get_options() const {
+  return m_options;
 }
 
-void Application::set_mouse_listener(mouse_listener_ptr&& value){
-  assert(static_cast<bool>(m_input_manager));
-  m_mouse_listner = std::move(value);
-  if(static_cast<bool>(m_mouse_listner)) {
-    if(0 != (m_input_context.mMouse = static_cast<OIS::Mouse*>(m_input_manager->createInputObject(OIS::OISMouse, true)))) {
-      windowResized();
-      m_input_context.mMouse->setEventCallback(this);
-    }
-  }
-  else if(m_input_context.mMouse) {
-    m_input_context.mMouse->setEventCallback(0);
-    m_input_manager->destroyInputObject(m_input_context.mMouse);
-    m_input_context.mMouse = 0;
+// Runs after the first frame, a budget violation stops rendering and
+// startApplication() throws once the loop has unwound.
+bool Application::finish_startup() {
+  m_startup.add("phase", "firstFrame", m_render_start, startup_profile::clock_t::now());
+  m_startup.finish();
+  if(!m_options.m_startup_report.empty())
+    m_startup.write_json(m_options.m_startup_report);
+  if(m_options.m_startup_budget.empty())
+    return true;
+  for(const std::string& value : m_startup.check(m_options.m_startup_budget)) {
+    Ogre::LogManager::getSingleton().logMessage("Startup budget exceeded, " + value, Ogre::LML_CRITICAL);
+    m_startup_error += (m_startup_error.empty() ? "Startup budget exceeded: " : "; ") + value;
   }
+  return m_startup_error.empty();
 }
 
  // Ogre::FrameListener
 bool Application::frameStarted(const Ogre::FrameEvent& value) {
-  m_input_context.capture();
-  return static_cast<bool>(m_frame_listener) && static_cast<bool>(m_frame_listener->m_started) ?
-    m_frame_listener->m_started(value) : true;
+  if(m_hitch_detector) {
+    const tracer::clock_t::time_point now = tracer::clock_t::now();
+    if(tracer::clock_t::time_point() != m_trace_frame && m_hitch_detector->frame(now - m_trace_frame))
+      Ogre::LogManager::getSingleton().logMessage("Frame hitch, trace of the last frames queued", Ogre::LML_NORMAL);
+    for(const std::string& error : m_hitch_detector->errors())
+      Ogre::LogManager::getSingleton().logMessage("Hitch trace not written: " + error, Ogre::LML_CRITICAL);
+    m_trace_frame = now;
+  }
+  tracer::begin("frame");
+  const time_point_t start = stamp();
+  {
+    TRACE_ZONE("input");
+    if(m_input_threaded)
+      drain_input();
+    else
+      m_input_context.capture();
+  }
+  const time_point_t captured = stamp();
+  // after the input phase is stamped, the last benchmark frame sorts and saves
+  m_render_system_selector.frame(value.timeSinceLastFrame * 1000.0);
+  TRACE_ZONE("frame_started");
+  if(m_resource_groups)
+    m_resource_groups->update();
+  const bool res = simulate() && m_frame_listener.m_started.dispatch(value);
+  if(m_frame_stats) {
+    m_phase_end = stamp();
+    m_sample.m_us[frame_stats::ph_frame] = frame_stats::elapsed(m_frame_start, start);
+    m_sample.m_us[frame_stats::ph_input] = frame_stats::elapsed(start, captured);
+    m_sample.m_us[frame_stats::ph_started] = frame_stats::elapsed(captured, m_phase_end);
+    m_frame_start = start;
+  }
+  return res;
 }
 
 bool Application::frameRenderingQueued(const Ogre::FrameEvent& value) {
-  return static_cast<bool>(m_frame_listener) && static_cast<bool>(m_frame_listener->m_rendering_queued) ?
-    m_frame_listener->m_rendering_queued(value) : true;
+  const time_point_t start = stamp();
+  TRACE_ZONE("frame_rendering_queued");
+  const bool res = m_frame_listener.m_rendering_queued.dispatch(value);
+  if(m_frame_stats) {
+    m_sample.m_us[frame_stats::ph_update] = frame_stats::elapsed(m_phase_end, start);
+    m_phase_end = stamp();
+    m_sample.m_us[frame_stats::ph_rendering_queued] = frame_stats::elapsed(start, m_phase_end);
+  }
+  return res;
 }
 
 bool Application::frameEnded(const Ogre::FrameEvent& value) {
-  return static_cast<bool>(m_frame_listener) && static_cast<bool>(m_frame_listener->m_ended) ?
-    m_frame_listener->m_ended(value) : true;
+  const time_point_t start = stamp();
+  bool res = true;
+  {
+    TRACE_ZONE("frame_ended");
+    res = m_frame_listener.m_ended.dispatch(value);
+  }
+  tracer::end("frame");
+  if(m_frame_stats) {
+    m_sample.m_us[frame_stats::ph_swap] = frame_stats::elapsed(m_phase_end, start);
+    m_sample.m_us[frame_stats::ph_ended] = frame_stats::elapsed(start, stamp());
+    m_frame_stats->push(m_sample);
+    if(m_frame_stats->need_collect())
+      m_frame_stats->collect();
+  }
+  if(!m_startup.finished())
+    res = finish_startup() && res;
+  return res;
 }
  
 // OIS::MouseListener  
 bool Application::mouseMoved(const OIS::MouseEvent& value) {
-  if(m_mouse_listner && m_mouse_listner->m_move)
-    return m_mouse_listner->m_move(value);
-  return true;
+  return on_input(input_event(input_event::mouse_moved, value));
 }
 
 bool Application::mousePressed(const OIS::MouseEvent& value, OIS::MouseButtonID id) {
-  if(m_mouse_listner && m_mouse_listner->m_pressed)
-    return m_mouse_listner->m_pressed(value, id);
-  return true;
+  return on_input(input_event(input_event::mouse_pressed, value, id));
 }
 
 bool Application::mouseReleased(const OIS::MouseEvent& value, OIS::MouseButtonID id ) {
-  if(m_mouse_listner && m_mouse_listner->m_released)
-    return m_mouse_listner->m_released(value, id);
-  return true;
+  return on_input(input_event(input_event::mouse_released, value, id));
 }
-// OIS::MouseListener  
+// OIS::KeyListener
 bool Application::keyPressed(const OIS::KeyEvent& value) {
-  if(m_key_listner && m_key_listner->m_pressed)
-    return m_key_listner->m_pressed(value);
-  return true;
+  return on_input(input_event(input_event::key_pressed, value));
 }
 
 bool Application::keyReleased(const OIS::KeyEvent& value) {
-  if(m_key_listner && m_key_listner->m_released)
-    return m_key_listner->m_released(value);
+  return on_input(input_event(input_event::key_released, value));
+}
+
+// Fixed steps of simulation_step() on steady_clock, frame listeners blend the
+// last two states with interpolation_alpha().
+bool Application::simulate() {
+  if(m_simulation_listener.m_step.empty())
+    return true;
+  TRACE_ZONE("simulate");
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(std::chrono::steady_clock::time_point() != m_simulation_time)
+    m_accumulator += std::chrono::duration<double>(now - m_simulation_time).count();
+  m_simulation_time = now;
+  bool res = true;
+  unsigned int steps = 0;
+  for(; m_accumulator >= m_simulation_step && steps < m_options.m_simulation_max_steps; ++steps) {
+    res = m_simulation_listener.m_step.dispatch(m_simulation_step) && res;
+    m_accumulator -= m_simulation_step;
+  }
+  // too far behind, drop the backlog rather than spiral
+  if(m_accumulator >= m_simulation_step)
+    m_accumulator = std::fmod(m_accumulator, m_simulation_step);
+  m_alpha = m_accumulator / m_simulation_step;
+  return res;
+}
+
+void Application::input_loop() {
+  tracer::set_thread_name("input");
+  while(m_input_running.load(std::memory_order_acquire)) {
+    const std::uint64_t extents = m_mouse_extents.exchange(0, std::memory_order_acquire);
+    if(0 != extents)
+      set_mouse_extents(static_cast<unsigned int>(extents >> 32), static_cast<unsigned int>(extents));
+    {
+      TRACE_ZONE("input_capture");
+      m_input_context.capture();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void Application::drain_input() {
+  input_event value;
+  while(m_input_queue.pop(value))
+    dispatch_input(value);
+}
+
+// called on the input thread when it is running
+bool Application::on_input(const input_event& value) {
+  if(!m_input_threaded)
+    return dispatch_input(value);
+  if(!m_input_queue.push(value))
+    ++m_input_dropped;
+  {
+    std::lock_guard<std::mutex> lock(m_wake_mutex);
+  }
+  m_wake.notify_one();
   return true;
 }
 
-void Application::windowResized() {
-  if(m_input_context.mMouse) {
-    const OIS::MouseState& ms = m_input_context.mMouse->getMouseState();
-    Ogre::RenderWindow* value = get_render_window();
-    ms.width = value->getWidth();
-    ms.height = value->getHeight();
+bool Application::dispatch_input(const input_event& value) {
+  m_input_time = value.m_time;
+  m_dirty = true;
+  switch(value.m_type) {
+    case input_event::key_pressed:
+      if(m_frame_stats && OIS::KC_F12 == value.m_key)
+        write_frame_stats();
+      return m_key_listener.m_pressed.dispatch(OIS::KeyEvent(m_input_context.mKeyboard, value.m_key, value.m_text));
+    case input_event::key_released:
+      return m_key_listener.m_released.dispatch(OIS::KeyEvent(m_input_context.mKeyboard, value.m_key, value.m_text));
+    case input_event::mouse_moved:
+      return m_mouse_listener.m_move.dispatch(OIS::MouseEvent(m_input_context.mMouse, value.m_state));
+    case input_event::mouse_pressed:
+      return m_mouse_listener.m_pressed.dispatch(OIS::MouseEvent(m_input_context.mMouse, value.m_state), value.m_button);
+    case input_event::mouse_released:
+      return m_mouse_listener.m_released.dispatch(OIS::MouseEvent(m_input_context.mMouse, value.m_state), value.m_button);
+  }
+  return true;
+}
+
+// a file that cannot be written is not worth the session, neither from F12 nor at exit
+void Application::write_frame_stats() {
+  try {
+    m_frame_stats->write_csv(m_options.m_frame_stats);
+  }
+  catch(const Ogre::Exception& e) {
+    Ogre::LogManager::getSingleton().logMessage("Frame stats not written: " + e.getDescription(),
+      Ogre::LML_CRITICAL);
+  }
+}
+
+void Application::write_trace() {
+  try {
+    tracer::write(m_options.m_trace);
+  }
+  catch(const Ogre::Exception& e) {
+    Ogre::LogManager::getSingleton().logMessage("Trace not written: " + e.getDescription(), Ogre::LML_CRITICAL);
+  }
+}
+
+void Application::render_frames(const unsigned int count) {
+  m_root->getRenderSystem()->_initRenderTargets();
+  m_root->clearEventTimes();
+  for(unsigned int i = 0; i < count; ++i)
+    if(!m_root->renderOneFrame())
+      break;
+}
+
+Application::time_point_t Application::stamp() const {
+  return m_frame_stats ? frame_stats::clock_t::now() : time_point_t();
+}
+
+// Renders only while something changed or an animation runs, otherwise sleeps
+// for at most 16 ms, less when an invalidate_at() timer is due or the input
+// thread posts an event. Window events, and input without the input thread,
+// are polled on every wake, they have no handle to block on. Animated frames are
+// paced to --frame-cap. A render system benchmark renders back to back until it
+// has its samples.
+void Application::render_loop() {
+  using clock_t = std::chrono::steady_clock;
+  const bool always = !m_options.m_on_demand;
+  const clock_t::duration period = m_options.m_frame_cap > 0.0 ?
+    std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(1.0 / m_options.m_frame_cap)) :
+    clock_t::duration::zero();
+  m_root->getRenderSystem()->_initRenderTargets();
+  m_root->clearEventTimes();
+  m_width = m_renderWindow->getWidth();
+  m_height = m_renderWindow->getHeight();
+  clock_t::time_point next_frame = clock_t::now();
+  bool idle = false;
+  while(!m_root->endRenderingQueued()) {
+    Ogre::WindowEventUtilities::messagePump();
+    if(m_renderWindow->isClosed())
+      break;
+    const bool benchmarking = m_render_system_selector.benchmarking();
+    if(!always && !benchmarking && !need_frame()) {
+      idle = true;
+      wait_idle(clock_t::now() + std::chrono::milliseconds(16));
+      continue;
+    }
+    if(idle) {
+      // do not let the simulation or frame events catch up on the idle time
+      idle = false;
+      m_simulation_time = clock_t::time_point();
+      m_root->clearEventTimes();
+      next_frame = clock_t::now();
+    }
+    else if(!benchmarking && clock_t::duration::zero() != period) {
+      pace(next_frame);
+      next_frame = std::max(next_frame + period, clock_t::now() - period);
+    }
+    m_dirty = false;
+    if(!m_root->renderOneFrame())
+      break;
+  }
+}
+
+bool Application::need_frame() {
+  if(m_input_threaded)
+    drain_input();
+  else
+    m_input_context.capture();
+  if(m_width != m_renderWindow->getWidth() || m_height != m_renderWindow->getHeight()) {
+    m_width = m_renderWindow->getWidth();
+    m_height = m_renderWindow->getHeight();
+    windowResized();
+    m_dirty = true;
+  }
+  for(watched_node& value : m_watched_nodes) {
+    const Ogre::Vector3& position = value.m_node->_getDerivedPosition();
+    const Ogre::Quaternion& orientation = value.m_node->_getDerivedOrientation();
+    const Ogre::Vector3& scale = value.m_node->_getDerivedScale();
+    if(position != value.m_position || orientation != value.m_orientation || scale != value.m_scale) {
+      value.m_position = position;
+      value.m_orientation = orientation;
+      value.m_scale = scale;
+      m_dirty = true;
+    }
+  }
+  if(std::chrono::steady_clock::time_point() != m_redraw_at && m_redraw_at <= std::chrono::steady_clock::now()) {
+    m_redraw_at = std::chrono::steady_clock::time_point();
+    m_dirty = true;
   }
+  return m_dirty || m_animating;
+}
+
+void Application::wait_idle(const std::chrono::steady_clock::time_point& deadline) {
+  TRACE_ZONE("idle");
+  const std::chrono::steady_clock::time_point until =
+    std::chrono::steady_clock::time_point() != m_redraw_at && m_redraw_at < deadline ? m_redraw_at : deadline;
+  if(m_input_threaded) {
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    m_wake.wait_until(lock, until, [&](){ return !m_input_queue.empty(); });
+  }
+  else
+    std::this_thread::sleep_until(until);
+}
+
+// sleep most of the way, spin the last stretch the scheduler cannot hit
+void Application::pace(const std::chrono::steady_clock::time_point& deadline) {
+  const std::chrono::steady_clock::duration spin = std::chrono::microseconds(1500);
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(deadline - now > spin)
+    std::this_thread::sleep_for(deadline - now - spin);
+  while(std::chrono::steady_clock::now() < deadline)
+    std::this_thread::yield();
+}
+
+// the input thread owns the mouse while it runs, it applies the extents before
+// its next capture
+void Application::windowResized() {
+  if(0 == m_input_context.mMouse)
+    return;
+  Ogre::RenderWindow* value = get_render_window();
+  if(m_input_threaded)
+    m_mouse_extents.store(static_cast<std::uint64_t>(value->getWidth()) << 32 | value->getHeight(),
+      std::memory_order_release);
+  else
+    set_mouse_extents(value->getWidth(), value->getHeight());
+}
+
+void Application::set_mouse_extents(const unsigned int width, const unsigned int height) {
+  const OIS::MouseState& ms = m_input_context.mMouse->getMouseState();
+  ms.width = width;
+  ms.height = height;
 }
 
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
-#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <OgreString.h>
 #include <OgreCommon.h>
 #include <OgreFrameListener.h>
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
 
 #include <InputContext.h>
 
@@ -13,11 +21,24 @@
 #include <OISKeyboard.h>
 #include <OISPrereqs.h>
 
+#include "frame_stats.h"
+#include "listener_registry.h"
+#include "mesh_cache.h"
+#include "render_system_selector.h"
+#include "resource_groups.h"
+#include "resource_index.h"
+#include "spsc_ring.h"
+#include "startup_profile.h"
+#include "trace.h"
+
 
 namespace Ogre
 {
   class Root;
+  class RenderTarget;
   class RenderWindow;
+  class Node;
+  class Plugin;
   class SceneManager;
   class Camera;
 }
@@ -34,7 +55,7 @@ class Application
 public:
   class frame_listener {
   public:
-    using frame_event_t = std::function<bool(const Ogre::FrameEvent&)>;
+    using frame_event_t = listener_registry<bool(const Ogre::FrameEvent&)>;
   public:
     frame_event_t m_started;
     frame_event_t m_rendering_queued;
@@ -42,26 +63,67 @@ public:
   };
   class mouse_listener {
   public:
-    using mouse_move_f = std::function<bool(const OIS::MouseEvent&)>;  
-    using mouse_button_event_f = std::function<bool(const OIS::MouseEvent&, OIS::MouseButtonID)>;
+    using mouse_move_f = listener_registry<bool(const OIS::MouseEvent&)>;
+    using mouse_button_event_f = listener_registry<bool(const OIS::MouseEvent&, OIS::MouseButtonID)>;
   public:
-    mouse_move_f m_move;  
+    mouse_move_f m_move;
     mouse_button_event_f m_pressed;
     mouse_button_event_f m_released;
   };
   class key_listener {
   public:
-    using key_event_f = std::function<bool(const OIS::KeyEvent&)>;  
+    using key_event_f = listener_registry<bool(const OIS::KeyEvent&)>;
   public:
-    key_event_f m_pressed;  
+    key_event_f m_pressed;
     key_event_f m_released;
   };
-  using frame_listener_ptr = std::unique_ptr<frame_listener>;
-  using mouse_listener_ptr = std::unique_ptr<mouse_listener>;
-  using key_listener_ptr = std::unique_ptr<key_listener>;
+  class simulation_listener {
+  public:
+    using step_event_t = listener_registry<bool(const double)>;
+  public:
+    step_event_t m_step;
+  };
+  class options {
+  public:
+    options();
+    options(int ac, char* av[]);
+  public:
+    bool m_headless = false;
+    unsigned int m_width = 800;
+    unsigned int m_height = 600;
+    unsigned int m_frames = 300;
+    Ogre::String m_frame_stats;
+    Ogre::String m_trace;
+    double m_hitch_budget = 0.0;
+    double m_hitch_window = 5.0;
+    bool m_input_thread = false;
+    double m_simulation_rate = 60.0;
+    unsigned int m_simulation_max_steps = 5;
+    // idle frames still wake every 16 ms to pump window events and, without
+    // --input-thread, to poll input; with it input wakes the loop at once
+    bool m_on_demand = false;
+    double m_frame_cap = 0.0;
+    Ogre::String m_resource_index = "resources.index";
+    Ogre::String m_startup_report;
+    Ogre::String m_startup_budget;
+    Ogre::String m_render_system;
+    bool m_render_benchmark = false;
+    Ogre::String m_render_cache = "render_system.cache";
+    bool m_vsync = false;
+    unsigned int m_fsaa = 0;  // samples asked for, the render system may offer fewer
+    unsigned int m_wheel_segments = 0;  // 0 keeps the tutorial default
+    Ogre::String m_mesh_cache = "mesh_cache";
+    bool m_packed_vertices = false;
+    unsigned int m_reels = 0;  // 0 keeps the tutorial's own reels
+    bool m_instanced_reels = false;
+    bool m_reel_arc = false;
+    Ogre::String m_raycast_reels;  // all, columns for every other column, empty for none
+    unsigned int m_virtual_strip = 0;  // symbols on every reel's logical strip, 0 for none
+    bool m_symbol_atlas = false;
+  };
 public:
   Application(const Ogre::String& plugin_config,
-    const Ogre::String& resource_config);
+    const Ogre::String& resource_config, const options& value = options());
   virtual ~Application();
 
   void startApplication();
@@ -71,29 +133,90 @@ public:
   virtual void createRenderWindow(const Ogre::String title = "Application",
     const unsigned int width = 800, const unsigned int height = 600,
     const bool full_screen = false, const Ogre::NameValuePairList* params = &Application::defparam );
+  void createOffscreenTarget(const unsigned int width, const unsigned int height);
   void parseResourceFileConfiguration();
   void initializeResources();
+  void require_resource_group(const Ogre::String& value);
+  void prefetch_resource_group(const Ogre::String& value);
+  resource_groups::progress_event_t& get_resource_progress();
+  Ogre::MeshPtr cached_mesh(const mesh_key& key, const mesh_cache::generator_t& generate);
   void start_input(OIS::ParamList value = Application::oisdefault);
   void stop_input();
+  frame_listener& get_frame_listener();
+  key_listener& get_key_listener();
+  mouse_listener& get_mouse_listener();
+  std::chrono::steady_clock::time_point input_time() const;
+  simulation_listener& get_simulation_listener();
+  double simulation_step() const;
+  double interpolation_alpha() const;
+  void invalidate();
+  void invalidate_at(const std::chrono::steady_clock::time_point& value);
+  void set_animating(const bool value);
+  void watch_node(Ogre::Node* value);
 public:
   static const Ogre::NameValuePairList defparam;
   static const OIS::ParamList oisdefault;
 protected:
   virtual void createScene();
   Ogre::SceneManager* create_scene_manager();
+  void install_plugin(const Ogre::String& name, Ogre::Plugin* value);
   Ogre::RenderWindow* get_render_window();
-  void set_frame_listener(frame_listener_ptr&& value);
-  void set_key_listener(key_listener_ptr&& value);
-  void set_mouse_listener(mouse_listener_ptr&& value);
+  Ogre::RenderTarget* get_render_target();
+  const options& get_options() const;
 protected:
   using input_manager_ptr = std::unique_ptr<OIS::InputManager, void(*)(OIS::InputManager*)>;
+  using time_point_t = frame_stats::clock_t::time_point;
 protected:
+  const options m_options;
   const Ogre::String m_plugin_config;
   const Ogre::String m_resource_config;
+  // declared before m_root, Ogre::Root destroys the archives it creates
+  std::unique_ptr<resource_index> m_resource_index;
+  // statically linked plugins are uninstalled by ~Root, they must outlive m_root
+  std::vector<std::unique_ptr<Ogre::Plugin>> m_static_plugins;
+  startup_profile m_startup;
   std::unique_ptr<Ogre::Root> m_root;
   input_manager_ptr m_input_manager;
+private:
+  class input_event {
+  public:
+    enum type { key_pressed, key_released, mouse_moved, mouse_pressed, mouse_released };
+  public:
+    input_event() = default;
+    input_event(const type value, const OIS::KeyEvent& key);
+    input_event(const type value, const OIS::MouseEvent& mouse, const OIS::MouseButtonID button = OIS::MB_Left);
+  public:
+    type m_type = key_pressed;
+    std::chrono::steady_clock::time_point m_time;
+    OIS::KeyCode m_key = OIS::KC_UNASSIGNED;
+    unsigned int m_text = 0;
+    OIS::MouseState m_state;
+    OIS::MouseButtonID m_button = OIS::MB_Left;
+  };
+  class watched_node {
+  public:
+    Ogre::Node* m_node;
+    Ogre::Vector3 m_position;
+    Ogre::Quaternion m_orientation;
+    Ogre::Vector3 m_scale;
+  };
 private:
   void windowResized();
+  void set_mouse_extents(const unsigned int width, const unsigned int height);
+  void render_loop();
+  bool need_frame();
+  void wait_idle(const std::chrono::steady_clock::time_point& deadline);
+  static void pace(const std::chrono::steady_clock::time_point& deadline);
+  bool simulate();
+  void input_loop();
+  void drain_input();
+  bool on_input(const input_event& value);
+  bool dispatch_input(const input_event& value);
+  void write_frame_stats();
+  void write_trace();
+  void render_frames(const unsigned int count);
+  bool finish_startup();
+  time_point_t stamp() const;
   // Ogre::FrameListener
   bool frameStarted(const Ogre::FrameEvent& value);
   bool frameRenderingQueued(const Ogre::FrameEvent& value);
@@ -108,7 +231,40 @@ private:
 private:
   OgreBites::InputContext m_input_context;
   Ogre::RenderWindow* m_renderWindow = 0;
-  frame_listener_ptr m_frame_listener;
-  key_listener_ptr m_key_listner;
-  mouse_listener_ptr m_mouse_listner;
+  Ogre::RenderTarget* m_render_target = 0;
+  render_system_selector m_render_system_selector;
+  Ogre::NameValuePairList m_window_params;
+  frame_listener m_frame_listener;
+  key_listener m_key_listener;
+  mouse_listener m_mouse_listener;
+  std::unique_ptr<resource_groups> m_resource_groups;
+  std::unique_ptr<mesh_cache> m_mesh_cache;
+  startup_profile::clock_t::time_point m_render_start;
+  Ogre::String m_startup_error;
+  std::unique_ptr<frame_stats> m_frame_stats;
+  frame_stats::sample m_sample;
+  time_point_t m_frame_start;
+  time_point_t m_phase_end;
+  std::unique_ptr<hitch_detector> m_hitch_detector;
+  tracer::clock_t::time_point m_trace_frame;
+  spsc_ring<input_event, 256> m_input_queue;
+  std::thread m_input_thread;
+  bool m_input_threaded = false;
+  std::atomic<bool> m_input_running{false};
+  std::atomic<unsigned int> m_input_dropped{0};
+  std::atomic<std::uint64_t> m_mouse_extents{0};  // width << 32 | height for the input thread, 0 when applied
+  std::chrono::steady_clock::time_point m_input_time;
+  simulation_listener m_simulation_listener;
+  const double m_simulation_step;
+  std::chrono::steady_clock::time_point m_simulation_time;
+  double m_accumulator = 0.0;
+  double m_alpha = 0.0;
+  bool m_dirty = true;
+  bool m_animating = false;
+  std::chrono::steady_clock::time_point m_redraw_at;
+  std::vector<watched_node> m_watched_nodes;
+  unsigned int m_width = 0;
+  unsigned int m_height = 0;
+  std::mutex m_wake_mutex;
+  std::condition_variable m_wake;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <numeric>
+
+#include "atlas_packer.h"
+
+skyline_packer::skyline_packer(const std::size_t width, const std::size_t height)
+    : m_width(width)
+    , m_height(height)
+    , m_skyline(1, segment{0, 0, width}) {
+}
+
+bool skyline_packer::insert(const std::size_t width, const std::size_t height, std::size_t& x, std::size_t& y) {
+  std::size_t best = m_skyline.size();
+  std::size_t best_top = m_height + 1;
+  std::size_t best_width = m_width + 1;
+  for(std::size_t i = 0; i < m_skyline.size(); ++i) {
+    std::size_t top = 0;
+    if(!fits(i, width, height, top))
+      continue;
+    if(top + height < best_top || (top + height == best_top && m_skyline[i].m_width < best_width)) {
+      best = i;
+      best_top = top + height;
+      best_width = m_skyline[i].m_width;
+    }
+  }
+  if(best == m_skyline.size())
+    return false;
+  x = m_skyline[best].m_x;
+  y = best_top - height;
+
+  // the new segment replaces what it covers, a partly covered one is cut
+  m_skyline.insert(m_skyline.begin() + best, segment{x, best_top, width});
+  for(std::size_t i = best + 1; i < m_skyline.size();) {
+    segment& item = m_skyline[i];
+    const std::size_t end = x + width;
+    if(item.m_x >= end)
+      break;
+    if(item.m_x + item.m_width <= end) {
+      m_skyline.erase(m_skyline.begin() + i);
+      continue;
+    }
+    item.m_width -= end - item.m_x;
+    item.m_x = end;
+    break;
+  }
+  for(std::size_t i = 0; i + 1 < m_skyline.size();) {
+    if(m_skyline[i].m_y == m_skyline[i + 1].m_y) {
+      m_skyline[i].m_width += m_skyline[i + 1].m_width;
+      m_skyline.erase(m_skyline.begin() + i + 1);
+    }
+    else
+      ++i;
+  }
+  m_used += width * height;
+  return true;
+}
+
+double skyline_packer::occupancy() const {
+  return double(m_used) / (m_width * m_height);
+}
+
+// resting on the highest segment under its width
+bool skyline_packer::fits(const std::size_t index, const std::size_t width, const std::size_t height,
+    std::size_t& y) const {
+  if(m_skyline[index].m_x + width > m_width)
+    return false;
+  y = 0;
+  std::size_t covered = 0;
+  for(std::size_t i = index; covered < width; ++i) {
+    y = std::max(y, m_skyline[i].m_y);
+    if(y + height > m_height)
+      return false;
+    covered += m_skyline[i].m_width;
+  }
+  return true;
+}
+
+std::size_t pack_atlas(std::vector<atlas_rect>& rects, const std::size_t page_width, const std::size_t page_height) {
+  std::vector<std::size_t> order(rects.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+    return rects[a].m_height > rects[b].m_height ||
+      (rects[a].m_height == rects[b].m_height && rects[a].m_width > rects[b].m_width);
+  });
+  std::vector<skyline_packer> pages;
+  for(const std::size_t i : order) {
+    atlas_rect& rect = rects[i];
+    if(rect.m_width > page_width || rect.m_height > page_height)
+      return 0;
+    // earlier pages first, they may still have a gap
+    rect.m_page = 0;
+    while(rect.m_page < pages.size() && !pages[rect.m_page].insert(rect.m_width, rect.m_height, rect.m_x, rect.m_y))
+      ++rect.m_page;
+    if(rect.m_page == pages.size()) {
+      pages.emplace_back(page_width, page_height);
+      pages.back().insert(rect.m_width, rect.m_height, rect.m_x, rect.m_y);
+    }
+  }
+  return pages.size();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Rectangle packing for texture atlases. A page is filled from y = 0 along
+// its skyline, the outline of everything placed so far; a rectangle goes
+// where its far edge stays closest to y = 0, into the narrower gap on ties.
+// Space under an overhang is lost, which costs little for symbols of similar
+// heights.
+class skyline_packer {
+public:
+  skyline_packer(const std::size_t width, const std::size_t height);
+  // false if the rectangle fits nowhere on the page
+  bool insert(const std::size_t width, const std::size_t height, std::size_t& x, std::size_t& y);
+  // fraction of the page covered by rectangles
+  double occupancy() const;
+private:
+  class segment {
+  public:
+    std::size_t m_x;
+    std::size_t m_y;
+    std::size_t m_width;
+  };
+  bool fits(const std::size_t index, const std::size_t width, const std::size_t height, std::size_t& y) const;
+private:
+  const std::size_t m_width;
+  const std::size_t m_height;
+  std::vector<segment> m_skyline;
+  std::size_t m_used = 0;
+};
+
+class atlas_rect {
+public:
+  std::size_t m_width;
+  std::size_t m_height;
+  std::size_t m_page = 0;  // the rest is set by pack_atlas
+  std::size_t m_x = 0;
+  std::size_t m_y = 0;
+};
+
+// Places the rectangles tallest first on as many pages as they need and
+// returns the page count, 0 if one of them is larger than a page.
+std::size_t pack_atlas(std::vector<atlas_rect>& rects, const std::size_t page_width, const std::size_t page_height);
@@ -11,15 +11,15 @@
 
 class baseapp : public Application {
 public:
-  baseapp();
+  baseapp(const options& value);
 };
 
-baseapp::baseapp() : Application("plugins.cfg", "resources-1.9.cfg") {
+baseapp::baseapp(const options& value) : Application("plugins.cfg", "resources-1.9.cfg", value) {
 }
 
 int main(int ac, char* av[]) {
   try {
-    baseapp app;
+    baseapp app(Application::options(ac, av));
     app.startApplication();
     return 0;
   }
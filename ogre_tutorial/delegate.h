@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Type erased callable stored in place. Unlike std::function it never allocates:
+// a callable larger than the buffer is a compile error.
+template<typename Signature, std::size_t Size = 4 * sizeof(void*)>
+class delegate;
+
+template<typename R, typename... Args, std::size_t Size>
+class delegate<R(Args...), Size> {
+public:
+  delegate() = default;
+  template<typename F, typename = typename std::enable_if<
+    !std::is_same<typename std::decay<F>::type, delegate>::value>::type>
+  delegate(F&& value) {
+    using functor_t = typename std::decay<F>::type;
+    static_assert(sizeof(functor_t) <= Size, "callable does not fit into delegate storage");
+    static_assert(alignof(functor_t) <= alignof(storage_t), "callable is over aligned for delegate storage");
+    new (&m_storage) functor_t(std::forward<F>(value));
+    m_invoke = &invoke<functor_t>;
+    m_manage = &manage<functor_t>;
+  }
+  delegate(const delegate& value) {
+    assign(value, op_copy);
+  }
+  delegate(delegate&& value) {
+    assign(value, op_move);
+  }
+  ~delegate() {
+    reset();
+  }
+  delegate& operator=(const delegate& value) {
+    if(this != &value) {
+      reset();
+      assign(value, op_copy);
+    }
+    return *this;
+  }
+  delegate& operator=(delegate&& value) {
+    if(this != &value) {
+      reset();
+      assign(value, op_move);
+    }
+    return *this;
+  }
+  explicit operator bool() const {
+    return 0 != m_invoke;
+  }
+  R operator()(Args... args) const {
+    return m_invoke(&m_storage, std::forward<Args>(args)...);
+  }
+  void reset() {
+    if(0 != m_manage)
+      m_manage(op_destroy, &m_storage, 0);
+    m_invoke = 0;
+    m_manage = 0;
+  }
+private:
+  using storage_t = typename std::aligned_storage<Size, alignof(std::max_align_t)>::type;
+  enum operation { op_copy, op_move, op_destroy };
+private:
+  void assign(const delegate& value, const operation op) {
+    if(0 != value.m_manage)
+      value.m_manage(op, &m_storage, &value.m_storage);
+    m_invoke = value.m_invoke;
+    m_manage = value.m_manage;
+  }
+  template<typename F>
+  static R invoke(void* data, Args... args) {
+    return (*static_cast<F*>(data))(std::forward<Args>(args)...);
+  }
+  template<typename F>
+  static void manage(const operation op, void* dst, void* src) {
+    switch(op) {
+      case op_copy:
+        new (dst) F(*static_cast<const F*>(src));
+        break;
+      case op_move:
+        new (dst) F(std::move(*static_cast<F*>(src)));
+        break;
+      case op_destroy:
+        static_cast<F*>(dst)->~F();
+        break;
+    }
+  }
+private:
+  mutable storage_t m_storage;
+  R (*m_invoke)(void*, Args...) = 0;
+  void (*m_manage)(operation, void*, void*) = 0;
+};
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <OgreException.h>
+
+#include "frame_stats.h"
+
+frame_stats::histogram::histogram() {
+  clear();
+}
+
+void frame_stats::histogram::add(const std::uint32_t us) {
+  ++m_buckets[bucket(us)];
+  ++m_count;
+  if(us > m_max)
+    m_max = us;
+}
+
+void frame_stats::histogram::clear() {
+  m_buckets.fill(0);
+  m_count = 0;
+  m_max = 0;
+}
+
+std::uint64_t frame_stats::histogram::count() const {
+  return m_count;
+}
+
+std::uint32_t frame_stats::histogram::max() const {
+  return m_max;
+}
+
+std::uint32_t frame_stats::histogram::percentile(const double value) const {
+  if(0 == m_count)
+    return 0;
+  std::uint64_t rank = static_cast<std::uint64_t>(value * m_count + 0.5);
+  if(0 == rank)
+    rank = 1;
+  std::uint64_t seen = 0;
+  for(std::size_t i = 0; i < bucket_count; ++i)
+    if((seen += m_buckets[i]) >= rank)
+      return std::min(upper_bound(i), m_max);
+  return m_max;
+}
+
+// exact below 32us, then 16 linear sub buckets per power of two (~6% error)
+std::size_t frame_stats::histogram::bucket(const std::uint32_t us) {
+  if(us < 32)
+    return us;
+  std::size_t msb = 31;
+  while(0 == (us & (1u << msb)))
+    --msb;
+  return 32 + (msb - 5) * 16 + ((us >> (msb - 4)) & 15);
+}
+
+std::uint32_t frame_stats::histogram::upper_bound(const std::size_t index) {
+  if(index < 32)
+    return static_cast<std::uint32_t>(index);
+  const std::size_t msb = 5 + (index - 32) / 16;
+  const std::uint64_t lower = static_cast<std::uint64_t>(16 + (index - 32) % 16) << (msb - 4);
+  return static_cast<std::uint32_t>(lower + (std::uint64_t(1) << (msb - 4)) - 1);
+}
+
+frame_stats::frame_stats() {
+}
+
+bool frame_stats::push(const sample& value) {
+  if(m_size < capacity) {
+    m_samples[m_size++] = value;
+    return true;
+  }
+  ++m_dropped;
+  return false;
+}
+
+void frame_stats::collect() {
+  for(std::size_t j = 0; j < m_size; ++j)
+    for(std::size_t i = 0; i < phase_count; ++i)
+      m_histograms[i].add(m_samples[j].m_us[i]);
+  m_size = 0;
+}
+
+void frame_stats::clear() {
+  collect();
+  for(histogram& value : m_histograms)
+    value.clear();
+  m_dropped = 0;
+}
+
+bool frame_stats::need_collect() const {
+  return m_size >= capacity / 2;
+}
+
+const frame_stats::histogram& frame_stats::get(const phase value) const {
+  return m_histograms[value];
+}
+
+void frame_stats::write_csv(const std::string& file_name) {
+  collect();
+  std::ofstream out(file_name.c_str(), std::ios::out | std::ios::trunc);
+  if(!out)
+    throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+      "Failed to open frame stats file: " + file_name, __FILE__);
+  out << "phase,count,p50_ms,p95_ms,p99_ms,max_ms\n" << std::fixed << std::setprecision(3);
+  for(std::size_t i = 0; i < phase_count; ++i) {
+    const histogram& h = m_histograms[i];
+    out << name(static_cast<phase>(i)) << ',' << h.count()
+      << ',' << h.percentile(0.50) / 1000.0
+      << ',' << h.percentile(0.95) / 1000.0
+      << ',' << h.percentile(0.99) / 1000.0
+      << ',' << h.max() / 1000.0 << '\n';
+  }
+  out << "dropped," << m_dropped << ",,,,\n";
+}
+
+const char* frame_stats::name(const phase value) {
+  static const char* names[phase_count] = {
+    "input", "started", "update", "rendering_queued", "swap", "ended", "frame"
+  };
+  return names[value];
+}
+
+std::uint32_t frame_stats::elapsed(const clock_t::time_point& from, const clock_t::time_point& to) {
+  const std::chrono::microseconds::rep us =
+    std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+  return us <= 0 ? 0 : static_cast<std::uint32_t>(us);
+}
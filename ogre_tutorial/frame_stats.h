@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Per-phase frame timings. The render thread appends one sample per frame to a
+// fixed buffer, collect() folds the samples into log-linear histograms. Both
+// run on the render thread, nothing is shared.
+class frame_stats {
+public:
+  enum phase {
+    ph_input,             // m_input_context.capture()
+    ph_started,           // user frame started callback
+    ph_update,            // scene graph update and render queue build
+    ph_rendering_queued,  // user frame rendering queued callback
+    ph_swap,              // gpu wait and buffer swap
+    ph_ended,             // user frame ended callback
+    ph_frame,             // frame start to next frame start
+    phase_count
+  };
+  using clock_t = std::chrono::steady_clock;
+  class sample {
+  public:
+    std::uint32_t m_us[phase_count];
+  };
+  class histogram {
+  public:
+    histogram();
+    void add(const std::uint32_t us);
+    void clear();
+    std::uint64_t count() const;
+    std::uint32_t max() const;
+    std::uint32_t percentile(const double value) const;
+  private:
+    static std::size_t bucket(const std::uint32_t us);
+    static std::uint32_t upper_bound(const std::size_t index);
+  private:
+    static const std::size_t bucket_count = 32 + 27 * 16;
+    std::array<std::uint64_t, bucket_count> m_buckets;
+    std::uint64_t m_count;
+    std::uint32_t m_max;
+  };
+public:
+  frame_stats();
+  bool push(const sample& value);
+  void collect();
+  void clear();
+  bool need_collect() const;
+  const histogram& get(const phase value) const;
+  void write_csv(const std::string& file_name);
+  static const char* name(const phase value);
+  static std::uint32_t elapsed(const clock_t::time_point& from, const clock_t::time_point& to);
+private:
+  static const std::size_t capacity = 1024;
+  std::array<sample, capacity> m_samples;
+  std::size_t m_size = 0;
+  std::array<histogram, phase_count> m_histograms;
+  std::uint64_t m_dropped = 0;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "delegate.h"
+
+// Any number of listeners ordered by priority (higher first, equal priorities in
+// subscription order). Every listener sees every event, dispatch() returns false
+// when any of them did. Subscribing and unsubscribing from inside a listener is
+// allowed, a listener may unsubscribe itself: delegates removed during a dispatch
+// are destroyed when the outermost dispatch returns. Dispatch never allocates.
+template<typename Signature>
+class listener_registry;
+
+template<typename... Args>
+class listener_registry<bool(Args...)> {
+public:
+  using delegate_t = delegate<bool(Args...)>;
+  using token_t = std::size_t;
+public:
+  token_t subscribe(delegate_t value, const int priority = 0) {
+    const token_t token = m_next++;
+    if(m_dispatching)
+      m_pending.push_back(entry{priority, token, std::move(value)});
+    else
+      insert(entry{priority, token, std::move(value)});
+    return token;
+  }
+  bool unsubscribe(const token_t value) {
+    for(std::vector<entry>* entries : {&m_entries, &m_pending})
+      for(entry& item : *entries)
+        if(value == item.m_token) {
+          // the delegate may be running, compact() destroys it after the dispatch
+          item.m_token = 0;
+          m_dirty = true;
+          if(!m_dispatching)
+            compact();
+          return true;
+        }
+    return false;
+  }
+  bool dispatch(Args... args) {
+    bool res = true;
+    const bool nested = m_dispatching;
+    m_dispatching = true;
+    for(std::size_t i = 0, count = m_entries.size(); i < count; ++i)
+      if(0 != m_entries[i].m_token && !m_entries[i].m_delegate(args...))
+        res = false;
+    m_dispatching = nested;
+    if(!nested && (m_dirty || !m_pending.empty()))
+      compact();
+    return res;
+  }
+  bool empty() const {
+    return m_entries.empty() && m_pending.empty();
+  }
+  void clear() {
+    m_pending.clear();
+    if(m_dispatching) {
+      for(entry& item : m_entries)
+        item.m_token = 0;
+      m_dirty = true;
+    }
+    else
+      m_entries.clear();
+  }
+private:
+  class entry {
+  public:
+    int m_priority;
+    token_t m_token;
+    delegate_t m_delegate;
+  };
+private:
+  void insert(entry&& value) {
+    typename std::vector<entry>::iterator it = std::upper_bound(m_entries.begin(), m_entries.end(), value,
+      [](const entry& a, const entry& b){ return a.m_priority > b.m_priority; });
+    m_entries.insert(it, std::move(value));
+  }
+  void compact() {
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+      [](const entry& value){ return 0 == value.m_token; }), m_entries.end());
+    for(entry& item : m_pending)
+      if(0 != item.m_token)
+        insert(std::move(item));
+    m_pending.clear();
+    m_dirty = false;
+  }
+private:
+  std::vector<entry> m_entries;
+  std::vector<entry> m_pending;
+  token_t m_next = 1;
+  bool m_dispatching = false;
+  bool m_dirty = false;
+};
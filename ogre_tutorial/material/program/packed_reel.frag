@@ -0,0 +1,14 @@
+#version 120
+
+// Fixed function lighting of the reel materials: ambient plus one light.
+
+uniform sampler2D strip;
+uniform vec4 ambient;
+uniform vec4 light_diffuse;
+
+varying vec2 uv;
+varying float diffuse;
+
+void main() {
+  gl_FragColor = texture2D(strip, uv) * vec4((ambient + light_diffuse * diffuse).rgb, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 120
+
+// Vertex program of the packed layout written by mesh_builder. The position
+// shorts arrive unnormalised and the node scale restores their units, the
+// normal is octahedral and the texture coordinate 15 bit unorm, both snorm16.
+
+attribute vec4 vertex;
+attribute vec2 normal;
+attribute vec2 uv0;
+
+uniform mat4 world_view_proj;
+uniform vec4 light_position;  // object space, in the stored units
+
+varying vec2 uv;
+varying float diffuse;
+
+vec3 octahedral(vec2 value) {
+  vec3 res = vec3(value, 1.0 - abs(value.x) - abs(value.y));
+  if(res.z < 0.0) {
+    vec2 side = vec2(value.x >= 0.0 ? 1.0 : -1.0, value.y >= 0.0 ? 1.0 : -1.0);
+    res.xy = (1.0 - abs(value.yx)) * side;
+  }
+  return normalize(res);
+}
+
+void main() {
+  vec3 position = vertex.xyz;
+  gl_Position = world_view_proj * vec4(position, 1.0);
+  vec3 light = normalize(light_position.xyz - position * light_position.w);
+  diffuse = max(dot(octahedral(normal / 32767.0), light), 0.0);
+  uv = uv0 / 32767.0;
+}
@@ -0,0 +1,22 @@
+#version 120
+
+// Vertex program of the reel arc meshes. The arc stays in place, the reel
+// spins by scrolling v with the renderable's custom parameter 0.
+
+attribute vec4 vertex;
+attribute vec3 normal;
+attribute vec2 uv0;
+
+uniform mat4 world_view_proj;
+uniform vec4 light_position;  // object space
+uniform vec4 scroll;
+
+varying vec2 uv;
+varying float diffuse;
+
+void main() {
+  gl_Position = world_view_proj * vertex;
+  vec3 light = normalize(light_position.xyz - vertex.xyz * light_position.w);
+  diffuse = max(dot(normal, light), 0.0);
+  uv = uv0 + vec2(0.0, scroll.x);
+}
@@ -0,0 +1,28 @@
+#version 120
+
+// Vertex program of reel_batch. Every instance turns the shared wheel about
+// its x axis by uv1.w, moves it to uv1.xyz and shifts the strip by uv2, all
+// in the space of the batch's node.
+
+attribute vec4 vertex;
+attribute vec3 normal;
+attribute vec2 uv0;
+attribute vec4 uv1;
+attribute float uv2;
+
+uniform mat4 world_view_proj;
+uniform vec4 light_position;  // object space of the batch
+
+varying vec2 uv;
+varying float diffuse;
+
+void main() {
+  float c = cos(uv1.w);
+  float s = sin(uv1.w);
+  mat3 rotation = mat3(1.0, 0.0, 0.0, 0.0, c, s, 0.0, -s, c);
+  vec3 position = rotation * vertex.xyz + uv1.xyz;
+  gl_Position = world_view_proj * vec4(position, 1.0);
+  vec3 light = normalize(light_position.xyz - position * light_position.w);
+  diffuse = max(dot(rotation * normal, light), 0.0);
+  uv = uv0 + vec2(0.0, uv2);
+}
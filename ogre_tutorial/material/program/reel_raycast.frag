@@ -0,0 +1,48 @@
+#version 120
+
+// Intersects the view ray with the reel's cylinder around the x axis, from
+// x = 0 to the width, and shades the hit like the textured wheel: u across
+// the width, v once around plus the scroll of custom parameter 0, the normal
+// towards the axis. Rays missing the cylinder are discarded and the depth is
+// that of the hit, so the silhouette is exact at any zoom.
+
+uniform sampler2D strip;
+uniform vec4 ambient;
+uniform vec4 light_diffuse;
+uniform vec4 light_position;  // object space
+uniform vec4 camera;  // object space
+uniform vec4 view;  // world space view direction
+uniform mat4 inverse_world;
+uniform mat4 projection;
+uniform mat4 world_view_proj;
+uniform vec4 scroll;
+
+varying vec3 position;
+varying vec2 cylinder;
+
+const float pi = 3.14159265358979;
+
+void main() {
+  float width = cylinder.x;
+  float radius = cylinder.y;
+  // parallel rays for an orthographic projection
+  vec3 direction = projection[3][3] > 0.5 ? (inverse_world * vec4(view.xyz, 0.0)).xyz : position - camera.xyz;
+  direction = normalize(direction);
+  float a = dot(direction.yz, direction.yz);
+  float b = dot(position.yz, direction.yz);
+  float c = dot(position.yz, position.yz) - radius * radius;
+  float discriminant = b * b - a * c;
+  if(a < 1e-6 || discriminant < 0.0)
+    discard;
+  vec3 hit = position + direction * ((-b - sqrt(discriminant)) / a);
+  if(hit.x < 0.0 || hit.x > width)
+    discard;
+
+  vec2 uv = vec2(hit.x / width, atan(hit.y, hit.z) / (2.0 * pi) + 0.5 + scroll.x);
+  vec3 normal = -vec3(0.0, hit.yz) / radius;
+  vec3 light = normalize(light_position.xyz - hit * light_position.w);
+  float diffuse = max(dot(normal, light), 0.0);
+  gl_FragColor = texture2D(strip, uv) * vec4((ambient + light_diffuse * diffuse).rgb, 1.0);
+  vec4 clip = world_view_proj * vec4(hit, 1.0);
+  gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+}
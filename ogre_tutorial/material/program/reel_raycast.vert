@@ -0,0 +1,18 @@
+#version 120
+
+// Vertex program of the ray cast reels: the proxy box around the cylinder
+// only passes its object space position on. uv0 holds width and radius.
+
+attribute vec4 vertex;
+attribute vec2 uv0;
+
+uniform mat4 world_view_proj;
+
+varying vec3 position;
+varying vec2 cylinder;
+
+void main() {
+  gl_Position = world_view_proj * vertex;
+  position = vertex.xyz;
+  cylinder = uv0;
+}
@@ -0,0 +1,25 @@
+#version 120
+
+// Fragment program of the virtual reel strips. v counts the stops around the
+// reel, every stop reads its symbol index from the reel's row of the stop
+// texture and samples that symbol's rectangle of the atlas page.
+
+uniform sampler2D strip;  // symbol atlas
+uniform sampler2D stops;  // atlas index per stop, a row per reel
+uniform vec4 ambient;
+uniform vec4 light_diffuse;
+uniform vec4 reel;  // custom 0: scroll, v of the reel's row
+uniform vec4 layout;  // custom 1: stops around the reel
+uniform vec4 rects[64];  // left, top, right, bottom of every symbol
+
+varying vec2 uv;
+varying float diffuse;
+
+void main() {
+  float position = uv.y * layout.x;
+  float stop = floor(position);
+  float index = floor(texture2D(stops, vec2((mod(stop, layout.x) + 0.5) / layout.x, reel.y)).r * 255.0 + 0.5);
+  vec4 rect = rects[int(index)];
+  vec2 cell = mix(rect.xy, rect.zw, vec2(uv.x, position - stop));
+  gl_FragColor = texture2D(strip, cell) * vec4((ambient + light_diffuse * diffuse).rgb, 1.0);
+}
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <OgreRoot.h>
+#include <OgreSubMesh.h>
+#include <OgreException.h>
+#include <OgreLogManager.h>
+#include <OgreMeshManager.h>
+#include <OgreHardwareBufferManager.h>
+
+#include "mesh_builder.h"
+#include "mesh_optimizer.h"
+#include "trace.h"
+
+namespace {
+
+  const float snorm16_max = 32767.0f;
+
+  // set while a shadow_buffer_scope exists
+  bool shadow_buffers = false;
+
+  std::int16_t snorm16(const float value) {
+    return static_cast<std::int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * snorm16_max));
+  }
+
+  // Unit vector folded onto the octahedron |x| + |y| + |z| = 1, the lower
+  // half mirrored over the diagonals, so two values keep the direction.
+  void octahedral(const float x, const float y, const float z, std::int16_t (&out)[2]) {
+    const float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+    float u = length > 0.0f ? x / length : 0.0f;
+    float v = length > 0.0f ? y / length : 0.0f;
+    if(z < 0.0f) {
+      const float folded = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+      v = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+      u = folded;
+    }
+    out[0] = snorm16(u);
+    out[1] = snorm16(v);
+  }
+
+} /* namespace */
+
+Ogre::MeshPtr create_mash(const Ogre::String& name, const Ogre::String& group, Ogre::VertexData* vd,
+    Ogre::HardwareIndexBufferSharedPtr ibuf, const std::size_t count, const Ogre::AxisAlignedBox& box,
+    const Ogre::Real radius) {
+  /// Create the mesh via the MeshManager
+  Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual(name, group);
+  msh->sharedVertexData = vd;
+  /// Create one submesh
+  Ogre::SubMesh* sub = msh->createSubMesh();
+
+  /// Set parameters of the submesh
+  sub->useSharedVertices = true;
+  sub->indexData->indexBuffer = ibuf;
+  sub->indexData->indexCount = count;
+  sub->indexData->indexStart = 0;
+
+  /// Set bounding information (for culling)
+  msh->_setBounds(box);
+  msh->_setBoundingSphereRadius(radius);
+
+  /// Notify -Mesh object that it has been loaded
+  msh->load();
+  msh->touch();
+  return msh;
+}
+
+mesh_builder::mesh_builder(const Ogre::String& name, const Ogre::String& group)
+    : m_name(name)
+    , m_group(group)
+    , m_vertex_data(new Ogre::VertexData()) {
+}
+
+mesh_builder::~mesh_builder() {
+  // end() was not reached, the vertex data still belongs to us
+  unlock();
+  delete m_vertex_data;
+}
+
+void mesh_builder::add_element(const unsigned short source, const Ogre::VertexElementType type,
+    const Ogre::VertexElementSemantic semantic) {
+  if(m_vertex_size.size() <= source)
+    m_vertex_size.resize(source + 1, 0);
+  m_vertex_data->vertexDeclaration->addElement(source, m_vertex_size[source], type, semantic);
+  m_vertex_size[source] += Ogre::VertexElement::getTypeSize(type);
+}
+
+// packed positions are stored as fractions of this value
+void mesh_builder::set_position_scale(const Ogre::Real value) {
+  m_position_scale = value;
+}
+
+// the node scale restoring the units of positions packed with position_scale
+Ogre::Real mesh_builder::packed_unit(const Ogre::Real position_scale) {
+  return position_scale / snorm16_max;
+}
+
+shadow_buffer_scope::shadow_buffer_scope()
+    : m_previous(shadow_buffers) {
+  shadow_buffers = true;
+}
+
+shadow_buffer_scope::~shadow_buffer_scope() {
+  shadow_buffers = m_previous;
+}
+
+void mesh_builder::set_optimization(const unsigned int value) {
+  m_optimization = value;
+}
+
+void mesh_builder::begin(const std::size_t vertex_count, const std::size_t index_count) {
+  if(m_building || 0 == m_vertex_data)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALID_STATE, "Mesh " + m_name + " is already built", __FILE__);
+  m_building = true;
+  Ogre::HardwareBufferManager& manager = Ogre::HardwareBufferManager::getSingleton();
+  m_vertex_data->vertexCount = vertex_count;
+  m_locked.resize(m_vertex_size.size(), 0);
+  m_staged.resize(0 != m_optimization ? m_vertex_size.size() : 0);
+  for(unsigned short source = 0; source < m_vertex_size.size(); ++source) {
+    if(0 == m_vertex_size[source])
+      continue;
+    Ogre::HardwareVertexBufferSharedPtr vbuf = manager.createVertexBuffer(m_vertex_size[source], vertex_count,
+      Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY, shadow_buffers);
+    m_vertex_data->vertexBufferBinding->setBinding(source, vbuf);
+    if(0 != m_optimization) {
+      m_staged[source].assign(m_vertex_size[source] * vertex_count, 0);
+      m_locked[source] = m_staged[source].data();
+    }
+    else
+      m_locked[source] = static_cast<unsigned char*>(vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+  }
+  // vertex_count - 1 is the largest index written
+  const Ogre::HardwareIndexBuffer::IndexType type =
+    vertex_count <= std::size_t(std::numeric_limits<Ogre::uint16>::max()) + 1 ?
+    Ogre::HardwareIndexBuffer::IT_16BIT : Ogre::HardwareIndexBuffer::IT_32BIT;
+  m_index_buffer = manager.createIndexBuffer(type, index_count, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY,
+    shadow_buffers);
+  if(0 != m_optimization) {
+    m_staged_indices.assign(index_count, 0);
+    m_indices32 = m_staged_indices.data();
+  }
+  else if(Ogre::HardwareIndexBuffer::IT_16BIT == type)
+    m_indices16 = static_cast<Ogre::uint16*>(m_index_buffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+  else
+    m_indices32 = static_cast<Ogre::uint32*>(m_index_buffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+  m_index = 0;
+  m_position = locate(Ogre::VES_POSITION, Ogre::VET_FLOAT3, Ogre::VET_SHORT4);
+  m_normal = locate(Ogre::VES_NORMAL, Ogre::VET_FLOAT3, Ogre::VET_SHORT2);
+  m_texture_coord = locate(Ogre::VES_TEXTURE_COORDINATES, Ogre::VET_FLOAT2, Ogre::VET_SHORT2);
+  m_colour = locate(Ogre::VES_DIFFUSE, Ogre::VET_COLOUR, Ogre::VET_COLOUR);
+  if(Ogre::VET_SHORT4 == m_position.m_type && m_position_scale <= 0)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Mesh " + m_name + " packs positions without a position scale", __FILE__);
+  m_render_system = Ogre::Root::getSingleton().getRenderSystem();
+  m_box.setNull();
+  m_squared_radius = 0;
+}
+
+Ogre::HardwareIndexBuffer::IndexType mesh_builder::index_type() const {
+  return m_index_buffer->getType();
+}
+
+void mesh_builder::position(const std::size_t vertex, const Ogre::Vector3& value) {
+  assert(0 != m_position.m_data && vertex < m_vertex_data->vertexCount);
+  store_position(vertex, float(value.x), float(value.y), float(value.z));
+  m_box.merge(value);
+  m_squared_radius = std::max(m_squared_radius, value.squaredLength());
+}
+
+void mesh_builder::normal(const std::size_t vertex, const Ogre::Vector3& value) {
+  assert(0 != m_normal.m_data && vertex < m_vertex_data->vertexCount);
+  store_normal(vertex, float(value.x), float(value.y), float(value.z));
+}
+
+void mesh_builder::texture_coord(const std::size_t vertex, const Ogre::Vector2& value) {
+  assert(0 != m_texture_coord.m_data && vertex < m_vertex_data->vertexCount);
+  store_texture_coord(vertex, float(value.x), float(value.y));
+}
+
+// Use render system to convert colour value since colour packing varies
+void mesh_builder::colour(const std::size_t vertex, const Ogre::ColourValue& value) {
+  assert(0 != m_colour.m_data && vertex < m_vertex_data->vertexCount);
+  Ogre::RGBA packed;
+  m_render_system->convertColourValue(value, &packed);
+  std::memcpy(m_colour.m_data + vertex * m_colour.m_stride, &packed, sizeof(packed));
+}
+
+void mesh_builder::positions(const std::size_t first, const std::size_t step, const std::size_t count,
+    const float* x, const float* y, const float* z) {
+  if(0 == count)
+    return;
+  assert(0 != m_position.m_data && first + (count - 1) * step < m_vertex_data->vertexCount);
+  Ogre::Vector3 lower(x[0], y[0], z[0]);
+  Ogre::Vector3 upper(lower);
+  float squared_radius = 0.0f;
+  for(std::size_t i = 0; i < count; ++i) {
+    store_position(first + i * step, x[i], y[i], z[i]);
+    lower.makeFloor(Ogre::Vector3(x[i], y[i], z[i]));
+    upper.makeCeil(Ogre::Vector3(x[i], y[i], z[i]));
+    squared_radius = std::max(squared_radius, x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+  }
+  m_box.merge(lower);
+  m_box.merge(upper);
+  m_squared_radius = std::max(m_squared_radius, Ogre::Real(squared_radius));
+}
+
+void mesh_builder::normals(const std::size_t first, const std::size_t step, const std::size_t count,
+    const float* x, const float* y, const float* z) {
+  assert(0 == count || (0 != m_normal.m_data && first + (count - 1) * step < m_vertex_data->vertexCount));
+  for(std::size_t i = 0; i < count; ++i) {
+    store_normal(first + i * step, x[i], y[i], z[i]);
+  }
+}
+
+void mesh_builder::texture_coords(const std::size_t first, const std::size_t step, const std::size_t count,
+    const float* u, const float* v) {
+  assert(0 == count || (0 != m_texture_coord.m_data && first + (count - 1) * step < m_vertex_data->vertexCount));
+  for(std::size_t i = 0; i < count; ++i) {
+    store_texture_coord(first + i * step, u[i], v[i]);
+  }
+}
+
+void mesh_builder::triangle(const std::size_t a, const std::size_t b, const std::size_t c) {
+  assert(m_index + 3 <= m_index_buffer->getNumIndexes());
+  assert(a < m_vertex_data->vertexCount && b < m_vertex_data->vertexCount && c < m_vertex_data->vertexCount);
+  if(0 != m_indices16) {
+    m_indices16[m_index++] = static_cast<Ogre::uint16>(a);
+    m_indices16[m_index++] = static_cast<Ogre::uint16>(b);
+    m_indices16[m_index++] = static_cast<Ogre::uint16>(c);
+  }
+  else {
+    m_indices32[m_index++] = static_cast<Ogre::uint32>(a);
+    m_indices32[m_index++] = static_cast<Ogre::uint32>(b);
+    m_indices32[m_index++] = static_cast<Ogre::uint32>(c);
+  }
+}
+
+void mesh_builder::indices(const Ogre::uint16* data, const std::size_t count) {
+  copy_indices(data, count);
+}
+
+void mesh_builder::indices(const Ogre::uint32* data, const std::size_t count) {
+  copy_indices(data, count);
+}
+
+Ogre::MeshPtr mesh_builder::end() {
+  if(!m_building)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALID_STATE, "Mesh " + m_name + " was not begun", __FILE__);
+  if(0 != m_optimization)
+    upload();
+  unlock();
+  m_building = false;
+  Ogre::VertexData* vd = m_vertex_data;
+  m_vertex_data = 0;
+  Ogre::Real radius = Ogre::Math::Sqrt(m_squared_radius);
+  if(Ogre::VET_SHORT4 == m_position.m_type && !m_box.isNull()) {
+    // bounds of the stored integers, the node scale brings them back
+    const Ogre::Real factor = 1 / packed_unit(m_position_scale);
+    m_box.setExtents(m_box.getMinimum() * factor, m_box.getMaximum() * factor);
+    radius *= factor;
+  }
+  return create_mash(m_name, m_group, vd, m_index_buffer, m_index, m_box, radius);
+}
+
+mesh_builder::element mesh_builder::locate(const Ogre::VertexElementSemantic semantic,
+    const Ogre::VertexElementType type, const Ogre::VertexElementType packed) const {
+  element res;
+  const Ogre::VertexElement* value = m_vertex_data->vertexDeclaration->findElementBySemantic(semantic);
+  if(0 == value)
+    return res;
+  if(type != value->getType() && packed != value->getType())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Mesh " + m_name + " declares an element type the builder can not write", __FILE__);
+  res.m_data = m_locked[value->getSource()] + value->getOffset();
+  res.m_stride = m_vertex_size[value->getSource()];
+  res.m_type = value->getType();
+  return res;
+}
+
+// Optimizes the staged triangles and vertices, then writes them in one go.
+void mesh_builder::upload() {
+  TRACE_ZONE("mesh_builder::upload");
+  const std::size_t vertex_count = m_vertex_data->vertexCount;
+  Ogre::uint32* indices = m_staged_indices.data();
+  const double before = acmr(indices, m_index);
+  if(0 != (m_optimization & cache_order))
+    optimize_vertex_cache(indices, m_index, vertex_count);
+  if(0 != (m_optimization & overdraw_order) && 0 != m_position.m_data) {
+    std::vector<float> xyz;
+    staged_positions(xyz);
+    optimize_overdraw(indices, m_index, xyz.data(), vertex_count);
+  }
+  if(0 != (m_optimization & fetch_order)) {
+    std::vector<Ogre::uint32> remap(vertex_count);
+    optimize_vertex_fetch(indices, m_index, vertex_count, remap.data());
+    for(std::vector<unsigned char>& staged : m_staged) {
+      if(staged.empty())
+        continue;
+      const std::size_t size = staged.size() / vertex_count;
+      std::vector<unsigned char> moved(staged.size());
+      for(std::size_t v = 0; v < vertex_count; ++v)
+        std::memcpy(&moved[remap[v] * size], &staged[v * size], size);
+      staged.swap(moved);
+    }
+  }
+  char report[128];
+  std::snprintf(report, sizeof(report), "Mesh %s: ACMR %.3f -> %.3f", m_name.c_str(), before, acmr(indices, m_index));
+  Ogre::LogManager::getSingleton().logMessage(report);
+
+  for(unsigned short source = 0; source < m_staged.size(); ++source)
+    if(!m_staged[source].empty())
+      m_vertex_data->vertexBufferBinding->getBuffer(source)->writeData(0, m_staged[source].size(),
+        m_staged[source].data(), true);
+  if(Ogre::HardwareIndexBuffer::IT_16BIT == m_index_buffer->getType()) {
+    const std::vector<Ogre::uint16> narrow(indices, indices + m_index);
+    m_index_buffer->writeData(0, m_index * sizeof(Ogre::uint16), narrow.data(), true);
+  }
+  else
+    m_index_buffer->writeData(0, m_index * sizeof(Ogre::uint32), indices, true);
+}
+
+// staged positions as x, y, z floats, packed ones in their stored units
+void mesh_builder::staged_positions(std::vector<float>& out) const {
+  const std::size_t vertex_count = m_vertex_data->vertexCount;
+  out.resize(vertex_count * 3);
+  for(std::size_t v = 0; v < vertex_count; ++v) {
+    const unsigned char* data = m_position.m_data + v * m_position.m_stride;
+    if(Ogre::VET_SHORT4 == m_position.m_type) {
+      std::int16_t packed[4];
+      std::memcpy(packed, data, sizeof(packed));
+      std::copy(packed, packed + 3, &out[v * 3]);
+    }
+    else
+      std::memcpy(&out[v * 3], data, 3 * sizeof(float));
+  }
+}
+
+// w is 1 so the stored position stays a point
+void mesh_builder::store_position(const std::size_t vertex, const float x, const float y, const float z) {
+  if(Ogre::VET_SHORT4 == m_position.m_type) {
+    const float scale = float(1 / m_position_scale);
+    const std::int16_t data[] = {snorm16(x * scale), snorm16(y * scale), snorm16(z * scale), 1};
+    write(m_position, vertex, data, 4);
+  }
+  else {
+    const float data[] = {x, y, z};
+    write(m_position, vertex, data, 3);
+  }
+}
+
+void mesh_builder::store_normal(const std::size_t vertex, const float x, const float y, const float z) {
+  if(Ogre::VET_SHORT2 == m_normal.m_type) {
+    std::int16_t data[2];
+    octahedral(x, y, z, data);
+    write(m_normal, vertex, data, 2);
+  }
+  else {
+    const float data[] = {x, y, z};
+    write(m_normal, vertex, data, 3);
+  }
+}
+
+// packed coordinates are clamped to [0, 1]
+void mesh_builder::store_texture_coord(const std::size_t vertex, const float u, const float v) {
+  if(Ogre::VET_SHORT2 == m_texture_coord.m_type) {
+    const std::int16_t data[] = {snorm16(std::max(u, 0.0f)), snorm16(std::max(v, 0.0f))};
+    write(m_texture_coord, vertex, data, 2);
+  }
+  else {
+    const float data[] = {u, v};
+    write(m_texture_coord, vertex, data, 2);
+  }
+}
+
+void mesh_builder::unlock() {
+  if(0 == m_vertex_data)
+    return;
+  for(unsigned short source = 0; source < m_locked.size(); ++source)
+    if(0 != m_locked[source] && m_staged.empty())
+      m_vertex_data->vertexBufferBinding->getBuffer(source)->unlock();
+  m_locked.assign(m_locked.size(), 0);
+  m_staged.clear();
+  m_staged_indices.clear();
+  if(!m_index_buffer.isNull() && m_index_buffer->isLocked())
+    m_index_buffer->unlock();
+  m_indices16 = 0;
+  m_indices32 = 0;
+}
+
+// a table of the buffer index type is copied as is, otherwise converted
+template<typename T>
+void mesh_builder::copy_indices(const T* data, const std::size_t count) {
+  assert(m_index + count <= m_index_buffer->getNumIndexes());
+  if(0 != m_indices16) {
+    if(sizeof(T) == sizeof(Ogre::uint16))
+      std::memcpy(m_indices16 + m_index, data, count * sizeof(T));
+    else
+      for(std::size_t i = 0; i < count; ++i) {
+        assert(data[i] < m_vertex_data->vertexCount);
+        m_indices16[m_index + i] = static_cast<Ogre::uint16>(data[i]);
+      }
+  }
+  else if(sizeof(T) == sizeof(Ogre::uint32))
+    std::memcpy(m_indices32 + m_index, data, count * sizeof(T));
+  else
+    std::copy(data, data + count, m_indices32 + m_index);
+  m_index += count;
+}
+
+// the locked memory may be write combined, stores only and no read back
+template<typename T>
+void mesh_builder::write(const element& value, const std::size_t vertex, const T* data, const std::size_t count) {
+  std::memcpy(value.m_data + vertex * value.m_stride, data, count * sizeof(T));
+}
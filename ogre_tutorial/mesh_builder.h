@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreMesh.h>
+#include <OgreVector2.h>
+#include <OgreVector3.h>
+#include <OgreColourValue.h>
+#include <OgreAxisAlignedBox.h>
+#include <OgreRenderSystem.h>
+#include <OgreHardwareIndexBuffer.h>
+#include <OgreHardwareVertexBuffer.h>
+
+/// Creates a mesh with one submesh using the shared vertex data and loads it.
+Ogre::MeshPtr create_mash(const Ogre::String& name, const Ogre::String& group, Ogre::VertexData* vd,
+  Ogre::HardwareIndexBufferSharedPtr ibuf, const std::size_t count, const Ogre::AxisAlignedBox& box,
+  const Ogre::Real radius);
+
+// Builds a single submesh mesh. Elements are declared per source. By default
+// begin() locks every buffer with discard and the writers store straight into
+// the locked memory. With set_optimization() the writers fill system memory
+// instead and end() reorders the triangles for the post transform vertex cache
+// and the vertices by first use (mesh_optimizer), logs the ACMR before and
+// after and uploads with writeData; worth the copies for meshes written in a
+// cache unfriendly order, not for the wheels, whose strips already are. The
+// index type is 16 bit while every
+// vertex can be addressed by it, 32 bit otherwise. Bounds and the bounding
+// radius around the origin follow the written positions.
+// Besides the float layout the writers store a packed one, chosen by the
+// declared element types: VET_SHORT4 positions as snorm16 of the position
+// scale, VET_SHORT2 normals octahedral encoded as snorm16 and VET_SHORT2
+// texture coordinates as unorm with 15 bits. The render systems of Ogre 1.9
+// pass shorts unnormalised, so the bounds are in the stored integers, the
+// node scales them back by packed_unit and a vertex program decodes normals
+// and texture coordinates.
+class mesh_builder {
+public:
+  enum optimization {
+    cache_order = 1,
+    overdraw_order = 2,  // clusters against overdraw, after cache_order
+    fetch_order = 4,
+  };
+public:
+  mesh_builder(const Ogre::String& name, const Ogre::String& group);
+  ~mesh_builder();
+  mesh_builder(const mesh_builder&) = delete;
+  mesh_builder& operator=(const mesh_builder&) = delete;
+  void add_element(const unsigned short source, const Ogre::VertexElementType type,
+    const Ogre::VertexElementSemantic semantic);
+  void set_position_scale(const Ogre::Real value);
+  static Ogre::Real packed_unit(const Ogre::Real position_scale);
+  void set_optimization(const unsigned int value);
+  void begin(const std::size_t vertex_count, const std::size_t index_count);
+  Ogre::HardwareIndexBuffer::IndexType index_type() const;
+  void position(const std::size_t vertex, const Ogre::Vector3& value);
+  void normal(const std::size_t vertex, const Ogre::Vector3& value);
+  void texture_coord(const std::size_t vertex, const Ogre::Vector2& value);
+  void colour(const std::size_t vertex, const Ogre::ColourValue& value);
+  // structure of arrays input for vertices first, first + step, ... count of them
+  void positions(const std::size_t first, const std::size_t step, const std::size_t count, const float* x,
+    const float* y, const float* z);
+  void normals(const std::size_t first, const std::size_t step, const std::size_t count, const float* x,
+    const float* y, const float* z);
+  void texture_coords(const std::size_t first, const std::size_t step, const std::size_t count, const float* u,
+    const float* v);
+  void triangle(const std::size_t a, const std::size_t b, const std::size_t c);
+  void indices(const Ogre::uint16* data, const std::size_t count);
+  void indices(const Ogre::uint32* data, const std::size_t count);
+  Ogre::MeshPtr end();
+private:
+  class element {
+  public:
+    unsigned char* m_data = 0;  // first vertex inside the locked buffer
+    std::size_t m_stride = 0;
+    Ogre::VertexElementType m_type = Ogre::VET_FLOAT3;
+  };
+private:
+  element locate(const Ogre::VertexElementSemantic semantic, const Ogre::VertexElementType type,
+    const Ogre::VertexElementType packed) const;
+  void store_position(const std::size_t vertex, const float x, const float y, const float z);
+  void store_normal(const std::size_t vertex, const float x, const float y, const float z);
+  void store_texture_coord(const std::size_t vertex, const float u, const float v);
+  void unlock();
+  void upload();
+  void staged_positions(std::vector<float>& out) const;
+  template<typename T>
+  void copy_indices(const T* data, const std::size_t count);
+  template<typename T>
+  static void write(const element& value, const std::size_t vertex, const T* data, const std::size_t count);
+private:
+  const Ogre::String m_name;
+  const Ogre::String m_group;
+  Ogre::VertexData* m_vertex_data;
+  std::vector<std::size_t> m_vertex_size;
+  std::vector<unsigned char*> m_locked;
+  unsigned int m_optimization = 0;
+  std::vector<std::vector<unsigned char>> m_staged;  // vertices per source while optimizing
+  std::vector<Ogre::uint32> m_staged_indices;
+  bool m_building = false;
+  Ogre::HardwareIndexBufferSharedPtr m_index_buffer;
+  Ogre::uint16* m_indices16 = 0;
+  Ogre::uint32* m_indices32 = 0;
+  std::size_t m_index = 0;
+  element m_position;
+  element m_normal;
+  element m_texture_coord;
+  element m_colour;
+  Ogre::RenderSystem* m_render_system = 0;
+  Ogre::Real m_position_scale = 0;
+  Ogre::AxisAlignedBox m_box;
+  Ogre::Real m_squared_radius = 0;
+};
+
+// The buffers of meshes built while it exists get a system memory shadow, so
+// they can be read back. Write only buffers without one read back undefined
+// data on GL and fail to lock on D3D9, which breaks Ogre::MeshSerializer.
+class shadow_buffer_scope {
+public:
+  shadow_buffer_scope();
+  ~shadow_buffer_scope();
+  shadow_buffer_scope(const shadow_buffer_scope&) = delete;
+  shadow_buffer_scope& operator=(const shadow_buffer_scope&) = delete;
+private:
+  const bool m_previous;
+};
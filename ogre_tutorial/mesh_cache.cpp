@@ -0,0 +1,160 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include <OgreDataStream.h>
+#include <OgreException.h>
+#include <OgreLogManager.h>
+#include <OgreMeshManager.h>
+#include <OgreMeshSerializer.h>
+#include <OgreResourceGroupManager.h>
+
+#include "trace.h"
+#include "mesh_builder.h"
+#include "mesh_cache.h"
+
+namespace {
+
+  // a read only mapping of a whole file, unmapped on destruction
+  class mapped_file {
+  public:
+    explicit mapped_file(const Ogre::String& file_name) {
+      const int fd = ::open(file_name.c_str(), O_RDONLY);
+      if(fd < 0)
+        return;
+      struct stat info;
+      if(0 == ::fstat(fd, &info) && info.st_size > 0) {
+        void* data = ::mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(MAP_FAILED != data) {
+          m_data = data;
+          m_size = info.st_size;
+        }
+      }
+      ::close(fd);
+    }
+    ~mapped_file() {
+      if(0 != m_data)
+        ::munmap(m_data, m_size);
+    }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+  public:
+    void* m_data = 0;
+    std::size_t m_size = 0;
+  };
+
+} /* namespace */
+
+mesh_key::mesh_key(const Ogre::String& name, const Ogre::String& generator, const unsigned int version)
+    : m_name(name)
+    , m_text(generator + ";version=" + std::to_string(version)) {
+}
+
+// %.17g keeps every bit of the value, 200 and 200.0 give the same key
+mesh_key& mesh_key::add(const char* label, const double value) {
+  char number[32];
+  std::snprintf(number, sizeof(number), "%.17g", value);
+  m_text += Ogre::String(";") + label + "=" + number;
+  return *this;
+}
+
+mesh_key& mesh_key::add(const char* label, const Ogre::String& value) {
+  m_text += Ogre::String(";") + label + "=" + value;
+  return *this;
+}
+
+const Ogre::String& mesh_key::name() const {
+  return m_name;
+}
+
+const Ogre::String& mesh_key::text() const {
+  return m_text;
+}
+
+// FNV-1a over the name and the parameters
+std::uint64_t mesh_key::hash() const {
+  std::uint64_t res = 14695981039346656037ull;
+  for(const char item : m_name + "|" + m_text) {
+    res ^= static_cast<unsigned char>(item);
+    res *= 1099511628211ull;
+  }
+  return res;
+}
+
+mesh_cache::mesh_cache(const Ogre::String& directory)
+    : m_directory(directory) {
+  ::mkdir(m_directory.c_str(), 0755);
+}
+
+Ogre::MeshPtr mesh_cache::get(const mesh_key& key, const generator_t& generate) {
+  const Ogre::String file_name = path(key);
+  Ogre::MeshPtr res = load(key, file_name);
+  if(!res.isNull())
+    return res;
+  {
+    // the serializer reads the buffers back
+    const shadow_buffer_scope scope;
+    res = generate();
+  }
+  store(key, res, file_name);
+  return res;
+}
+
+Ogre::String mesh_cache::path(const mesh_key& key) const {
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(key.hash()));
+  return m_directory + "/" + key.name() + "-" + hash + ".mesh";
+}
+
+// A file that fails to import is removed and the mesh generated again.
+Ogre::MeshPtr mesh_cache::load(const mesh_key& key, const Ogre::String& file_name) const {
+  TRACE_ZONE("mesh_cache::load");
+  const mapped_file file(file_name);
+  if(0 == file.m_data)
+    return Ogre::MeshPtr();
+  Ogre::MeshManager& manager = Ogre::MeshManager::getSingleton();
+  Ogre::MeshPtr res = manager.createManual(key.name(), Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  try {
+    Ogre::DataStreamPtr stream(OGRE_NEW Ogre::MemoryDataStream(file.m_data, file.m_size, false, true));
+    Ogre::MeshSerializer().importMesh(stream, res.getPointer());
+  }
+  catch(const Ogre::Exception& e) {
+    Ogre::LogManager::getSingleton().logMessage("Mesh cache " + file_name + " discarded: " + e.getDescription(),
+      Ogre::LML_CRITICAL);
+    manager.remove(key.name());
+    std::remove(file_name.c_str());
+    return Ogre::MeshPtr();
+  }
+  res->load();
+  return res;
+}
+
+// written next to the final name and renamed, a crash never leaves half a mesh
+void mesh_cache::store(const mesh_key& key, const Ogre::MeshPtr& mesh, const Ogre::String& file_name) const {
+  TRACE_ZONE("mesh_cache::store");
+  const Ogre::String prefix = key.name() + "-";
+  if(DIR* dir = ::opendir(m_directory.c_str())) {
+    while(const dirent* entry = ::readdir(dir)) {
+      const Ogre::String name(entry->d_name);
+      if(0 == name.compare(0, prefix.size(), prefix) && name.size() == prefix.size() + 16 + 5 &&
+          m_directory + "/" + name != file_name)
+        std::remove((m_directory + "/" + name).c_str());
+    }
+    ::closedir(dir);
+  }
+  const Ogre::String temporary = file_name + ".tmp";
+  try {
+    Ogre::MeshSerializer().exportMesh(mesh.getPointer(), temporary);
+  }
+  catch(const Ogre::Exception& e) {
+    Ogre::LogManager::getSingleton().logMessage("Mesh cache " + file_name + " not written: " + e.getDescription(),
+      Ogre::LML_CRITICAL);
+    std::remove(temporary.c_str());
+    return;
+  }
+  std::rename(temporary.c_str(), file_name.c_str());
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <OgreString.h>
+#include <OgreMesh.h>
+
+// Identifies a generated mesh: the mesh name, the generator with its version
+// and every parameter that changes the geometry. Bump the version when a
+// generator changes its output for the same parameters.
+class mesh_key {
+public:
+  mesh_key(const Ogre::String& name, const Ogre::String& generator, const unsigned int version);
+  mesh_key& add(const char* label, const double value);
+  mesh_key& add(const char* label, const Ogre::String& value);
+  const Ogre::String& name() const;
+  const Ogre::String& text() const;
+  std::uint64_t hash() const;
+private:
+  Ogre::String m_name;
+  Ogre::String m_text;
+};
+
+// Directory of generated meshes written with Ogre::MeshSerializer. A mesh is
+// stored as <name>-<key hash>.mesh, so changed parameters or a new generator
+// version miss and regenerate; the stale files of that name are removed when
+// the new one is written. A hit maps the file and imports it without running
+// the generator. A miss runs it in a shadow_buffer_scope for the serializer.
+class mesh_cache {
+public:
+  using generator_t = std::function<Ogre::MeshPtr()>;
+public:
+  explicit mesh_cache(const Ogre::String& directory);
+  mesh_cache(const mesh_cache&) = delete;
+  mesh_cache& operator=(const mesh_cache&) = delete;
+  Ogre::MeshPtr get(const mesh_key& key, const generator_t& generate);
+private:
+  Ogre::String path(const mesh_key& key) const;
+  Ogre::MeshPtr load(const mesh_key& key, const Ogre::String& file_name) const;
+  void store(const mesh_key& key, const Ogre::MeshPtr& mesh, const Ogre::String& file_name) const;
+private:
+  const Ogre::String m_directory;
+};
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "mesh_optimizer.h"
+
+namespace {
+
+  const std::uint32_t unused = ~std::uint32_t(0);
+
+  // Forsyth's scoring, the cache here only ranks vertices
+  const std::size_t score_cache_size = 32;
+  const float cache_decay_power = 1.5f;
+  const float last_triangle_score = 0.75f;
+  const float valence_boost_scale = 2.0f;
+  const float valence_boost_power = 0.5f;
+
+  float vertex_score(const int cache_position, const std::uint32_t remaining) {
+    if(0 == remaining)
+      return -1.0f;
+    float res = 0.0f;
+    if(cache_position >= 0) {
+      if(cache_position < 3)
+        res = last_triangle_score;
+      else
+        res = std::pow(1.0f - float(cache_position - 3) / (score_cache_size - 3), cache_decay_power);
+    }
+    return res + valence_boost_scale * std::pow(float(remaining), -valence_boost_power);
+  }
+
+  // Triangles around every vertex, the first m_remaining[v] of its range are
+  // those not emitted yet.
+  class adjacency {
+  public:
+    adjacency(const std::uint32_t* indices, const std::size_t index_count, const std::size_t vertex_count)
+        : m_offsets(vertex_count + 1, 0)
+        , m_triangles(index_count)
+        , m_remaining(vertex_count, 0) {
+      for(std::size_t i = 0; i < index_count; ++i)
+        ++m_remaining[indices[i]];
+      for(std::size_t v = 0; v < vertex_count; ++v)
+        m_offsets[v + 1] = m_offsets[v] + m_remaining[v];
+      std::vector<std::uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+      for(std::size_t i = 0; i < index_count; ++i)
+        m_triangles[fill[indices[i]]++] = std::uint32_t(i / 3);
+    }
+    void remove(const std::uint32_t vertex, const std::uint32_t triangle) {
+      std::uint32_t* first = &m_triangles[m_offsets[vertex]];
+      std::uint32_t* last = first + m_remaining[vertex];
+      std::iter_swap(std::find(first, last, triangle), last - 1);
+      --m_remaining[vertex];
+    }
+  public:
+    std::vector<std::uint32_t> m_offsets;
+    std::vector<std::uint32_t> m_triangles;
+    std::vector<std::uint32_t> m_remaining;
+  };
+
+} /* namespace */
+
+double acmr(const std::uint32_t* indices, const std::size_t index_count, const std::size_t cache_size) {
+  if(index_count < 3)
+    return 0.0;
+  std::vector<std::uint32_t> cache;
+  std::size_t misses = 0;
+  for(std::size_t i = 0; i < index_count; ++i) {
+    if(cache.end() != std::find(cache.begin(), cache.end(), indices[i]))
+      continue;
+    ++misses;
+    cache.insert(cache.begin(), indices[i]);
+    if(cache.size() > cache_size)
+      cache.pop_back();
+  }
+  return double(misses) / (index_count / 3);
+}
+
+void optimize_vertex_cache(std::uint32_t* indices, const std::size_t index_count, const std::size_t vertex_count) {
+  const std::size_t triangle_count = index_count / 3;
+  if(triangle_count < 2)
+    return;
+  adjacency around(indices, index_count, vertex_count);
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> score(vertex_count);
+  for(std::size_t v = 0; v < vertex_count; ++v)
+    score[v] = vertex_score(-1, around.m_remaining[v]);
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<char> emitted(triangle_count, 0);
+  for(std::size_t t = 0; t < triangle_count; ++t)
+    triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+  std::vector<std::uint32_t> res;
+  res.reserve(index_count);
+  std::vector<std::uint32_t> cache;
+  std::vector<std::uint32_t> next;
+  std::size_t cursor = 0;  // no triangle before it is left
+  std::size_t best = std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+  while(res.size() < index_count) {
+    if(best >= triangle_count) {
+      // dead end, nothing in the cache has triangles left
+      while(emitted[cursor])
+        ++cursor;
+      best = cursor;
+    }
+    const std::uint32_t* triangle = indices + best * 3;
+    emitted[best] = 1;
+    res.insert(res.end(), triangle, triangle + 3);
+    for(std::size_t k = 0; k < 3; ++k)
+      around.remove(triangle[k], std::uint32_t(best));
+
+    // the triangle's vertices move to the front, the rest shift back
+    next.assign(triangle, triangle + 3);
+    for(const std::uint32_t vertex : cache)
+      if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+        next.push_back(vertex);
+    for(std::size_t i = 0; i < next.size(); ++i)
+      cache_position[next[i]] = i < score_cache_size ? int(i) : -1;
+    for(const std::uint32_t vertex : next)
+      score[vertex] = vertex_score(cache_position[vertex], around.m_remaining[vertex]);
+
+    // rescore the triangles around the cache and take the best of them
+    best = triangle_count;
+    float best_score = -1.0f;
+    for(const std::uint32_t vertex : next) {
+      const std::uint32_t* first = &around.m_triangles[around.m_offsets[vertex]];
+      for(const std::uint32_t* t = first; t != first + around.m_remaining[vertex]; ++t) {
+        const std::uint32_t* corner = indices + *t * 3;
+        triangle_score[*t] = score[corner[0]] + score[corner[1]] + score[corner[2]];
+        if(triangle_score[*t] > best_score) {
+          best_score = triangle_score[*t];
+          best = *t;
+        }
+      }
+    }
+    if(next.size() > score_cache_size)
+      next.resize(score_cache_size);
+    cache.swap(next);
+  }
+  std::copy(res.begin(), res.end(), indices);
+}
+
+void optimize_overdraw(std::uint32_t* indices, const std::size_t index_count, const float* positions,
+    const std::size_t vertex_count, const std::size_t cache_size) {
+  const std::size_t triangle_count = index_count / 3;
+  if(triangle_count < 2)
+    return;
+  // a cluster starts where all three vertices miss the cache
+  std::vector<std::size_t> clusters;
+  std::vector<std::uint32_t> cache;
+  for(std::size_t t = 0; t < triangle_count; ++t) {
+    std::size_t misses = 0;
+    for(std::size_t k = 0; k < 3; ++k) {
+      const std::uint32_t vertex = indices[t * 3 + k];
+      if(cache.end() != std::find(cache.begin(), cache.end(), vertex))
+        continue;
+      ++misses;
+      cache.insert(cache.begin(), vertex);
+      if(cache.size() > cache_size)
+        cache.pop_back();
+    }
+    if(0 == t || 3 == misses)
+      clusters.push_back(t);
+  }
+  clusters.push_back(triangle_count);
+  if(clusters.size() < 3)
+    return;
+
+  // area weighted centroid and normal of the mesh and of every cluster
+  class weighted {
+  public:
+    double m_centroid[3] = {};
+    double m_normal[3] = {};
+    double m_area = 0.0;
+  };
+  std::vector<weighted> cluster(clusters.size() - 1);
+  weighted mesh;
+  for(std::size_t c = 0; c + 1 < clusters.size(); ++c)
+    for(std::size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      assert(std::max({indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]}) < vertex_count);
+      const float* a = positions + indices[t * 3] * 3;
+      const float* b = positions + indices[t * 3 + 1] * 3;
+      const float* d = positions + indices[t * 3 + 2] * 3;
+      const double u[] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      const double v[] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      const double normal[] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+      const double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+      for(weighted* item : {&cluster[c], &mesh}) {
+        for(std::size_t k = 0; k < 3; ++k) {
+          item->m_centroid[k] += (a[k] + b[k] + d[k]) / 3.0 * area;
+          item->m_normal[k] += normal[k];
+        }
+        item->m_area += area;
+      }
+    }
+  for(std::size_t k = 0; k < 3; ++k)
+    mesh.m_centroid[k] /= mesh.m_area > 0.0 ? mesh.m_area : 1.0;
+  std::vector<double> key(cluster.size());
+  for(std::size_t c = 0; c < cluster.size(); ++c) {
+    const weighted& item = cluster[c];
+    const double area = item.m_area > 0.0 ? item.m_area : 1.0;
+    key[c] = 0.0;
+    for(std::size_t k = 0; k < 3; ++k)
+      key[c] += (item.m_centroid[k] / area - mesh.m_centroid[k]) * item.m_normal[k];
+  }
+  std::vector<std::size_t> order(cluster.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+    return key[a] > key[b];
+  });
+  std::vector<std::uint32_t> res;
+  res.reserve(index_count);
+  for(const std::size_t c : order)
+    res.insert(res.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+  std::copy(res.begin(), res.end(), indices);
+}
+
+void optimize_vertex_fetch(std::uint32_t* indices, const std::size_t index_count, const std::size_t vertex_count,
+    std::uint32_t* remap) {
+  std::fill(remap, remap + vertex_count, unused);
+  std::uint32_t next = 0;
+  for(std::size_t i = 0; i < index_count; ++i) {
+    if(unused == remap[indices[i]])
+      remap[indices[i]] = next++;
+    indices[i] = remap[indices[i]];
+  }
+  for(std::size_t v = 0; v < vertex_count; ++v)
+    if(unused == remap[v])
+      remap[v] = next++;
+}
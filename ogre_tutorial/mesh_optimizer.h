@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Post processing of indexed triangle lists before they are uploaded. The
+// triangle order is optimised for the post transform vertex cache with
+// Forsyth's linear speed algorithm, which does not depend on the exact cache
+// size; it can then be reordered by clusters against overdraw (Sander et al.)
+// and the vertices renumbered in the order the triangles first use them, so
+// the vertex fetch walks the buffer forwards.
+
+// Average cache miss ratio, transformed vertices per triangle with a FIFO
+// cache of cache_size entries. 0.5 is the ideal of a large regular grid, 3
+// means nothing is shared.
+double acmr(const std::uint32_t* indices, const std::size_t index_count, const std::size_t cache_size = 16);
+
+void optimize_vertex_cache(std::uint32_t* indices, const std::size_t index_count, const std::size_t vertex_count);
+
+// Splits the cache optimised order where the simulated cache starts cold and
+// moves clusters facing away from the mesh centre to the front, they are the
+// ones most likely to occlude the others. positions holds x, y, z per vertex.
+void optimize_overdraw(std::uint32_t* indices, const std::size_t index_count, const float* positions,
+  const std::size_t vertex_count, const std::size_t cache_size = 16);
+
+// Renumbers the vertices by first use and rewrites the indices. remap gets
+// the new number of every old vertex, unreferenced vertices keep their
+// relative order after the used ones.
+void optimize_vertex_fetch(std::uint32_t* indices, const std::size_t index_count, const std::size_t vertex_count,
+  std::uint32_t* remap);
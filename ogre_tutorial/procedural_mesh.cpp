@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include <OgreException.h>
+#include <OgreMaterialManager.h>
+#include <OgreTechnique.h>
+#include <OgrePass.h>
+#include <OgreSubMesh.h>
+#include <OgreMeshManager.h>
+#include <OgrePixelCountLodStrategy.h>
+
+#include "trace.h"
+#include "mesh_builder.h"
+#include "procedural_mesh.h"
+#include "wheel_kernel.h"
+#include "wheel_tables.h"
+
+namespace {
+
+  // 32 byte aligned for the AVX2 kernel
+  float* allocate_floats(scratch_arena& arena, const std::size_t count) {
+    return static_cast<float*>(arena.allocate(count * sizeof(float), 32));
+  }
+
+  const float* constant(scratch_arena& arena, const std::size_t count, const float value) {
+    float* res = allocate_floats(arena, count);
+    std::fill(res, res + count, value);
+    return res;
+  }
+
+  wheel_ring_soa allocate_rings(scratch_arena& arena, const std::size_t count) {
+    wheel_ring_soa res;
+    res.m_y = allocate_floats(arena, count);
+    res.m_z = allocate_floats(arena, count);
+    res.m_normal_y = allocate_floats(arena, count);
+    res.m_normal_z = allocate_floats(arena, count);
+    res.m_v = allocate_floats(arena, count);
+    return res;
+  }
+
+  class wheel_rings {
+  public:
+    const float* m_y;
+    const float* m_z;
+    const float* m_normal_y;
+    const float* m_normal_z;
+    const float* m_v;
+    const std::uint16_t* m_indices16 = 0;  // baked tables only
+    const std::uint32_t* m_indices32 = 0;
+  };
+
+  template<std::size_t face_count, bool textured>
+  wheel_rings baked_rings(scratch_arena& arena, const Ogre::Real radius) {
+    using layout = wheel_layout<face_count, textured>;
+    const typename layout::table_t& table = layout::table;
+    float* y = allocate_floats(arena, layout::ring_count);
+    float* z = allocate_floats(arena, layout::ring_count);
+    for(std::size_t i = 0; i < layout::ring_count; ++i) {
+      y[i] = table.m_sin[i] * radius;
+      z[i] = table.m_cos[i] * radius;
+    }
+    wheel_rings res{y, z, table.m_normal_sin, table.m_normal_cos, table.m_v};
+    if constexpr(std::is_same<typename layout::index_t, std::uint16_t>::value)
+      res.m_indices16 = table.m_indices;
+    else
+      res.m_indices32 = table.m_indices;
+    return res;
+  }
+
+  // The face counts the tutorials use come from tables, others from the kernel.
+  // A textured wheel coarser by stride keeps the first ring of the full one.
+  wheel_rings rings(scratch_arena& arena, const std::size_t face_count, const bool textured,
+      const Ogre::Real radius, const std::size_t stride = 1) {
+    if(!textured && 36 == face_count)
+      return baked_rings<36, false>(arena, radius);
+    if(textured && 144 == face_count && 1 == stride)
+      return baked_rings<144, true>(arena, radius);
+    const std::size_t ring_count = textured ? face_count + 1 : face_count;
+    const double step = 2 * M_PI / face_count;
+    const double start = textured ? -M_PI + step / stride : -M_PI;
+    const wheel_ring_params params{start, step, step / 2, textured ? -1.0f : 1.0f,
+      radius, textured ? 1.0f / face_count : 0.0f};
+    const wheel_ring_soa soa = allocate_rings(arena, ring_count);
+    generate_wheel_rings(params, ring_count, soa);
+    return wheel_rings{soa.m_y, soa.m_z, soa.m_normal_y, soa.m_normal_z, soa.m_v};
+  }
+
+  void wheel_indices(mesh_builder& builder, const wheel_rings& value, const std::size_t face_count,
+      const std::size_t vertex_count) {
+    if(0 != value.m_indices16)
+      builder.indices(value.m_indices16, face_count * 2 * 3);
+    else if(0 != value.m_indices32)
+      builder.indices(value.m_indices32, face_count * 2 * 3);
+    else
+      for(std::size_t v = 0; v < face_count * 2; v += 2) {
+        builder.triangle(v, (v + 3) % vertex_count, v + 1);
+        builder.triangle(v, (v + 2) % vertex_count, (v + 3) % vertex_count);
+      }
+  }
+
+  // Float or packed position, normal and texture coordinate elements. The
+  // packed positions are fractions of extent, the largest coordinate.
+  void add_textured_elements(mesh_builder& builder, const vertex_format format, const unsigned short normal_source,
+      const unsigned short texture_source, const Ogre::Real extent) {
+    const bool packed = vf_packed == format;
+    builder.add_element(0, packed ? Ogre::VET_SHORT4 : Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+    builder.add_element(normal_source, packed ? Ogre::VET_SHORT2 : Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+    builder.add_element(texture_source, packed ? Ogre::VET_SHORT2 : Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
+    if(packed)
+      builder.set_position_scale(extent);
+  }
+
+  const std::size_t patch_columns = 3;
+  const std::size_t patch_rows = 6;
+  const Ogre::Real patch_cell = 50.0f;
+
+  Ogre::Real patch_extent() {
+    return std::max(patch_columns - 1, patch_rows - 1) * patch_cell;
+  }
+
+  Ogre::Real wheel_extent(const Ogre::Real radius, const Ogre::Real width) {
+    return std::max(std::fabs(radius), std::fabs(width));
+  }
+
+  //     A-----B
+  //    /|    /|
+  //   / |   / |
+  //  /  D--/--C
+  // E--/--F  /
+  // | /   | /
+  // |/    |/
+  // H-----G
+  const Ogre::Real cube_corners[8][3] = {
+    {-1,  1, -1}, { 1,  1, -1}, { 1, -1, -1}, {-1, -1, -1},
+    {-1,  1,  1}, { 1,  1,  1}, { 1, -1,  1}, {-1, -1,  1},
+  };
+
+  // two counter clockwise triangles per cube face, seen from outside
+  const unsigned short cube_faces[12][3] = {
+    {0, 2, 3}, {0, 1, 2}, {1, 6, 2}, {1, 5, 6}, {4, 6, 5}, {4, 7, 6},
+    {0, 7, 4}, {0, 3, 7}, {0, 5, 1}, {0, 4, 5}, {2, 7, 3}, {2, 6, 7},
+  };
+
+  void check_face_count(const Ogre::String& name, const std::size_t face_count) {
+    if(face_count < 3)
+      throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Wheel " + name + " needs at least 3 faces", __FILE__);
+  }
+
+} /* namespace */
+
+void create_colour_material(const Ogre::String& name) {
+  Ogre::MaterialManager& manager = Ogre::MaterialManager::getSingleton();
+  if(manager.resourceExists(name))
+    return;
+  Ogre::MaterialPtr material = manager.create(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
+}
+
+Ogre::MeshPtr create_colour_cube(const Ogre::String& name, const Ogre::Real half_size) {
+  TRACE_ZONE("create_colour_cube");
+  static const Ogre::ColourValue colours[8] = {
+    Ogre::ColourValue(1.0, 0.0, 0.0), Ogre::ColourValue(1.0, 1.0, 0.0),
+    Ogre::ColourValue(0.0, 1.0, 0.0), Ogre::ColourValue(0.0, 0.0, 0.0),
+    Ogre::ColourValue(1.0, 0.0, 1.0), Ogre::ColourValue(1.0, 1.0, 1.0),
+    Ogre::ColourValue(0.0, 1.0, 1.0), Ogre::ColourValue(0.0, 0.0, 1.0),
+  };
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  builder.add_element(0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+  builder.add_element(0, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+  builder.add_element(1, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
+  // the face table is written by hand
+  builder.set_optimization(mesh_builder::cache_order | mesh_builder::fetch_order);
+  builder.begin(8, 36);
+  for(std::size_t i = 0; i < 8; ++i) {
+    const Ogre::Vector3 corner(cube_corners[i][0], cube_corners[i][1], cube_corners[i][2]);
+    builder.position(i, corner * half_size);
+    builder.normal(i, corner.normalisedCopy());
+    builder.colour(i, colours[i]);
+  }
+  for(const unsigned short (&face)[3] : cube_faces)
+    builder.triangle(face[0], face[1], face[2]);
+  return builder.end();
+}
+
+Ogre::MeshPtr create_patch(const Ogre::String& name, const bool separate_sources, const vertex_format format) {
+  TRACE_ZONE("create_patch");
+  const std::size_t columns = patch_columns;
+  const std::size_t rows = patch_rows;
+  const Ogre::Real cell = patch_cell;
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  add_textured_elements(builder, format, separate_sources ? 1 : 0, separate_sources ? 2 : 0, patch_extent());
+  // cells in row major order, which misses the cache once rows outgrow it
+  builder.set_optimization(mesh_builder::cache_order | mesh_builder::fetch_order);
+  builder.begin(columns * rows, (columns - 1) * (rows - 1) * 2 * 3);
+  for(std::size_t row = 0; row < rows; ++row)
+    for(std::size_t column = 0; column < columns; ++column) {
+      const std::size_t v = row * columns + column;
+      builder.position(v, Ogre::Vector3(column * cell, row * cell, 0.0f));
+      builder.normal(v, Ogre::Vector3::UNIT_Z);
+      builder.texture_coord(v, Ogre::Vector2(Ogre::Real(column) / (columns - 1), Ogre::Real(row) / (rows - 1)));
+      if(row + 1 < rows && column + 1 < columns) {
+        builder.triangle(v, v + 1, v + columns + 1);
+        builder.triangle(v, v + columns + 1, v + columns);
+      }
+    }
+  return builder.end();
+}
+
+Ogre::Real patch_packed_scale() {
+  return mesh_builder::packed_unit(patch_extent());
+}
+
+Ogre::MeshPtr create_colour_wheel(const Ogre::String& name, const std::size_t face_count, const Ogre::Real radius,
+    const Ogre::Real width, scratch_arena& arena) {
+  TRACE_ZONE("create_colour_wheel");
+  check_face_count(name, face_count);
+  const scratch_arena::marker rewind(arena);
+  const std::size_t vertex_count = face_count * 2;
+  const wheel_rings ring = rings(arena, face_count, false, radius);
+  const float* zero = constant(arena, face_count, 0.0f);
+  const float* right = constant(arena, face_count, width);
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  builder.add_element(0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+  builder.add_element(0, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+  builder.add_element(1, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
+  builder.begin(vertex_count, face_count * 2 * 3);
+  builder.positions(0, 2, face_count, zero, ring.m_y, ring.m_z);
+  builder.positions(1, 2, face_count, right, ring.m_y, ring.m_z);
+  builder.normals(0, 2, face_count, zero, ring.m_normal_y, ring.m_normal_z);
+  builder.normals(1, 2, face_count, zero, ring.m_normal_y, ring.m_normal_z);
+  for(std::size_t i = 0; i < face_count; ++i) {
+    const int dd = i % 7;
+    builder.colour(i * 2, Ogre::ColourValue(dd & 1, dd & 2, dd & 4));
+    builder.colour(i * 2 + 1, Ogre::ColourValue(dd & 4, dd & 2, dd & 1));
+  }
+  wheel_indices(builder, ring, face_count, vertex_count);
+  return builder.end();
+}
+
+Ogre::MeshPtr create_textured_wheel(const Ogre::String& name, const std::size_t face_count, const Ogre::Real radius,
+    const Ogre::Real width, const vertex_format format, scratch_arena& arena) {
+  return create_textured_wheel_level(name, face_count, face_count, radius, width, format, arena);
+}
+
+Ogre::MeshPtr create_textured_wheel_level(const Ogre::String& name, const std::size_t face_count,
+    const std::size_t level_faces, const Ogre::Real radius, const Ogre::Real width, const vertex_format format,
+    scratch_arena& arena) {
+  TRACE_ZONE("create_textured_wheel");
+  check_face_count(name, level_faces);
+  if(0 == level_faces || 0 != face_count % level_faces)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Wheel " + name + " level faces do not divide the face count", __FILE__);
+  const scratch_arena::marker rewind(arena);
+  const std::size_t ring_count = level_faces + 1;
+  const wheel_rings ring = rings(arena, level_faces, true, radius, face_count / level_faces);
+  const float* zero = constant(arena, ring_count, 0.0f);
+  const float* one = constant(arena, ring_count, 1.0f);
+  const float* right = constant(arena, ring_count, width);
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  add_textured_elements(builder, format, 0, 1, wheel_extent(radius, width));
+  builder.begin(ring_count * 2, level_faces * 2 * 3);
+  builder.positions(0, 2, ring_count, zero, ring.m_y, ring.m_z);
+  builder.positions(1, 2, ring_count, right, ring.m_y, ring.m_z);
+  builder.normals(0, 2, ring_count, zero, ring.m_normal_y, ring.m_normal_z);
+  builder.normals(1, 2, ring_count, zero, ring.m_normal_y, ring.m_normal_z);
+  builder.texture_coords(0, 2, ring_count, zero, ring.m_v);
+  builder.texture_coords(1, 2, ring_count, one, ring.m_v);
+  wheel_indices(builder, ring, level_faces, ring_count * 2);
+  return builder.end();
+}
+
+Ogre::MeshPtr create_reel_arc(const Ogre::String& name, const std::size_t face_count, const Ogre::Real arc,
+    const Ogre::Real radius, const Ogre::Real width, scratch_arena& arena) {
+  TRACE_ZONE("create_reel_arc");
+  if(0 == face_count || arc <= 0 || arc > 2 * Ogre::Math::PI)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Reel arc " + name + " needs faces and an arc", __FILE__);
+  const scratch_arena::marker rewind(arena);
+  const std::size_t ring_count = face_count + 1;
+  const double step = double(arc) / face_count;
+  const wheel_ring_params params{-arc / 2.0, step, step / 2, -1.0f, radius, float(step / (2 * M_PI))};
+  const wheel_ring_soa ring = allocate_rings(arena, ring_count);
+  generate_wheel_rings(params, ring_count, ring);
+  // v as on a full strip, 0.5 faces the camera
+  for(std::size_t i = 0; i < ring_count; ++i)
+    ring.m_v[i] += 0.5f - float(arc / (4 * M_PI));
+  const float* zero = constant(arena, ring_count, 0.0f);
+  const float* one = constant(arena, ring_count, 1.0f);
+  const float* right = constant(arena, ring_count, width);
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  add_textured_elements(builder, vf_float, 0, 1, wheel_extent(radius, width));
+  builder.begin(ring_count * 2, face_count * 2 * 3);
+  builder.positions(0, 2, ring_count, zero, ring.m_y, ring.m_z);
+  builder.positions(1, 2, ring_count, right, ring.m_y, ring.m_z);
+  builder.normals(0, 2, ring_count, zero, ring.m_normal_y, ring.m_normal_z);
+  builder.normals(1, 2, ring_count, zero, ring.m_normal_y, ring.m_normal_z);
+  builder.texture_coords(0, 2, ring_count, zero, ring.m_v);
+  builder.texture_coords(1, 2, ring_count, one, ring.m_v);
+  wheel_indices(builder, wheel_rings{ring.m_y, ring.m_z, ring.m_normal_y, ring.m_normal_z, ring.m_v}, face_count,
+    ring_count * 2);
+  return builder.end();
+}
+
+Ogre::MeshPtr create_symbol_wheel(const Ogre::String& name, const std::vector<Ogre::FloatRect>& stops,
+    const std::size_t faces_per_stop, const Ogre::Real radius, const Ogre::Real width, const vertex_format format,
+    scratch_arena& arena) {
+  TRACE_ZONE("create_symbol_wheel");
+  const std::size_t face_count = stops.size() * faces_per_stop;
+  check_face_count(name, face_count);
+  const scratch_arena::marker rewind(arena);
+  const wheel_rings ring = rings(arena, face_count, true, radius);
+  const std::size_t stop_vertices = (faces_per_stop + 1) * 2;
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  add_textured_elements(builder, format, 0, 0, wheel_extent(radius, width));
+  builder.begin(stops.size() * stop_vertices, face_count * 2 * 3);
+  for(std::size_t stop = 0; stop < stops.size(); ++stop) {
+    const Ogre::FloatRect& rect = stops[stop];
+    for(std::size_t i = 0; i <= faces_per_stop; ++i) {
+      const std::size_t r = stop * faces_per_stop + i;
+      const std::size_t v = stop * stop_vertices + i * 2;
+      const Ogre::Real along = rect.top + (rect.bottom - rect.top) * i / faces_per_stop;
+      const Ogre::Vector3 normal(0.0f, ring.m_normal_y[r], ring.m_normal_z[r]);
+      builder.position(v, Ogre::Vector3(0.0f, ring.m_y[r], ring.m_z[r]));
+      builder.position(v + 1, Ogre::Vector3(width, ring.m_y[r], ring.m_z[r]));
+      builder.normal(v, normal);
+      builder.normal(v + 1, normal);
+      builder.texture_coord(v, Ogre::Vector2(rect.left, along));
+      builder.texture_coord(v + 1, Ogre::Vector2(rect.right, along));
+      if(i < faces_per_stop) {
+        builder.triangle(v, v + 3, v + 1);
+        builder.triangle(v, v + 2, v + 3);
+      }
+    }
+  }
+  return builder.end();
+}
+
+Ogre::MeshPtr create_reel_proxy(const Ogre::String& name, const Ogre::Real radius, const Ogre::Real width) {
+  TRACE_ZONE("create_reel_proxy");
+  mesh_builder builder(name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  builder.add_element(0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+  builder.add_element(0, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
+  builder.begin(8, 36);
+  for(std::size_t i = 0; i < 8; ++i) {
+    builder.position(i, Ogre::Vector3((cube_corners[i][0] + 1) / 2 * width, cube_corners[i][1] * radius,
+      cube_corners[i][2] * radius));
+    builder.texture_coord(i, Ogre::Vector2(width, radius));
+  }
+  for(const unsigned short (&face)[3] : cube_faces)
+    builder.triangle(face[0], face[1], face[2]);
+  return builder.end();
+}
+
+Ogre::Real textured_wheel_packed_scale(const Ogre::Real radius, const Ogre::Real width) {
+  return mesh_builder::packed_unit(wheel_extent(radius, width));
+}
+
+// A level replaces the finer one once a face of that would span fewer than
+// lod_face_pixels pixels around the rim. The strategy measures the bounding
+// sphere around the origin, which also covers the width.
+std::vector<wheel_lod> textured_wheel_lods(const Ogre::String& name, const std::size_t face_count,
+    const Ogre::Real radius, const Ogre::Real width) {
+  const Ogre::Real lod_face_pixels = 4;
+  const std::size_t lod_min_faces = 12;
+  const Ogre::Real sphere = std::sqrt(radius * radius + width * width) / radius;
+  std::vector<wheel_lod> res;
+  for(std::size_t faces = face_count; 0 == faces % 2 && faces / 2 >= lod_min_faces; faces /= 2) {
+    const Ogre::Real rim = faces * lod_face_pixels / (2 * Ogre::Math::PI);
+    res.push_back(wheel_lod{name + "_lod" + std::to_string(res.size() + 1), faces / 2,
+      Ogre::Math::PI * rim * rim * sphere * sphere});
+  }
+  return res;
+}
+
+void set_wheel_lods(const Ogre::MeshPtr& mesh, const std::vector<wheel_lod>& levels, const Ogre::String& material) {
+  mesh->removeLodLevels();
+  mesh->setLodStrategy(Ogre::PixelCountLodStrategy::getSingletonPtr());
+  mesh->getSubMesh(0)->setMaterialName(material);
+  Ogre::MeshManager& manager = Ogre::MeshManager::getSingleton();
+  for(const wheel_lod& level : levels) {
+    manager.getByName(level.m_name)->getSubMesh(0)->setMaterialName(material);
+    mesh->createManualLodLevel(level.m_pixel_count, level.m_name);
+  }
+}
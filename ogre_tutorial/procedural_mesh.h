@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreMesh.h>
+#include <OgreCommon.h>
+#include <OgreResourceGroupManager.h>
+
+#include "scratch_arena.h"
+
+/// Part of every mesh_key of these generators, bump it when one of them
+/// produces different geometry for the same parameters.
+const unsigned int procedural_mesh_version = 2;
+
+/// Vertex layout of the patch and the textured wheel. vf_float keeps 32 bytes
+/// of floats a vertex, vf_packed writes the 16 byte packed layout of
+/// mesh_builder: the node has to scale the entity by the generator's
+/// packed_scale and the material has to use the packed_reel programs.
+enum vertex_format { vf_float, vf_packed };
+
+/// Material showing the vertex colours of the colour meshes, created once.
+void create_colour_material(const Ogre::String& name);
+
+/// Cube of eight shared vertices centred on the origin, one colour per corner.
+Ogre::MeshPtr create_colour_cube(const Ogre::String& name, const Ogre::Real half_size);
+
+/// 100 x 250 patch in the xy plane facing +z, made of 2 x 5 quads. With
+/// separate_sources position, normal and texture coordinates each get their
+/// own buffer, otherwise they are interleaved in one.
+Ogre::MeshPtr create_patch(const Ogre::String& name, const bool separate_sources,
+  const vertex_format format = vf_float);
+
+/// Node scale of a vf_packed patch.
+Ogre::Real patch_packed_scale();
+
+/// Closed ring of face_count quads around the x axis, from x = 0 to x = width.
+/// The colours cycle every seven faces and every vertex carries the outward
+/// normal of the face that follows it.
+Ogre::MeshPtr create_colour_wheel(const Ogre::String& name, const std::size_t face_count, const Ogre::Real radius,
+  const Ogre::Real width, scratch_arena& arena = scratch_arena::for_thread());
+
+/// Ring of face_count quads around the x axis textured with one strip: u runs
+/// across the width, v once around the wheel, so the first ring is repeated at
+/// the seam with v = 1. Normals face the axis where the tutorials put the light.
+Ogre::MeshPtr create_textured_wheel(const Ogre::String& name, const std::size_t face_count, const Ogre::Real radius,
+  const Ogre::Real width, const vertex_format format = vf_float, scratch_arena& arena = scratch_arena::for_thread());
+
+/// The textured wheel with level_faces of its face_count faces, which have to
+/// divide it. The rings are every (face_count / level_faces)th ring of the full
+/// wheel with the same angle and v, so the strip does not swim between levels.
+Ogre::MeshPtr create_textured_wheel_level(const Ogre::String& name, const std::size_t face_count,
+  const std::size_t level_faces, const Ogre::Real radius, const Ogre::Real width,
+  const vertex_format format = vf_float, scratch_arena& arena = scratch_arena::for_thread());
+
+/// Only the part of a reel facing the camera (+z): face_count quads over arc
+/// radians centred on the z axis, textured and lit like the textured wheel.
+/// It does not turn; the reel_arc vertex program scrolls v by the custom
+/// parameter 0 of the renderable and the texture wraps.
+Ogre::MeshPtr create_reel_arc(const Ogre::String& name, const std::size_t face_count, const Ogre::Real arc,
+  const Ogre::Real radius, const Ogre::Real width, scratch_arena& arena = scratch_arena::for_thread());
+
+/// Reel of stops.size() stops around the x axis, faces_per_stop quads each,
+/// shaped like the textured wheel. Every stop shows its own rectangle of a
+/// texture, usually a symbol of a symbol_atlas page: u runs across the width
+/// from left to right, v around the stop from top to bottom. The stops do not
+/// share vertices, so no coordinate is interpolated across two symbols.
+Ogre::MeshPtr create_symbol_wheel(const Ogre::String& name, const std::vector<Ogre::FloatRect>& stops,
+  const std::size_t faces_per_stop, const Ogre::Real radius, const Ogre::Real width,
+  const vertex_format format = vf_float, scratch_arena& arena = scratch_arena::for_thread());
+
+/// Box around a reel of that radius and width for the reel_raycast programs,
+/// which intersect the view ray with the cylinder per pixel. Every texture
+/// coordinate holds width and radius.
+Ogre::MeshPtr create_reel_proxy(const Ogre::String& name, const Ogre::Real radius, const Ogre::Real width);
+
+/// One mesh of a wheel's LOD chain and the pixel count below which it is used.
+class wheel_lod {
+public:
+  Ogre::String m_name;
+  std::size_t m_face_count;
+  Ogre::Real m_pixel_count;
+};
+
+/// Levels of a textured wheel, halving the faces while they stay even and at
+/// least 12; named name_lod1, name_lod2, ...
+std::vector<wheel_lod> textured_wheel_lods(const Ogre::String& name, const std::size_t face_count,
+  const Ogre::Real radius, const Ogre::Real width);
+
+/// Registers the level meshes, which have to exist, as manual LODs of mesh
+/// with the pixel count strategy. Entities do not pass their material on to
+/// manual levels, so it is set on every submesh.
+void set_wheel_lods(const Ogre::MeshPtr& mesh, const std::vector<wheel_lod>& levels, const Ogre::String& material);
+
+/// Node scale of a vf_packed textured wheel of that radius and width.
+Ogre::Real textured_wheel_packed_scale(const Ogre::Real radius, const Ogre::Real width);
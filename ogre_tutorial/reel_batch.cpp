@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include <OgreSubMesh.h>
+#include <OgreException.h>
+#include <OgreNode.h>
+#include <OgreHardwareBufferManager.h>
+
+#include "trace.h"
+#include "reel_batch.h"
+
+reel_batch::reel_batch(const Ogre::String& name, const Ogre::MeshPtr& mesh, const std::size_t capacity)
+    : Ogre::SimpleRenderable(name)
+    , m_mesh(mesh)
+    , m_capacity(capacity)
+    , m_reel_radius(mesh->getBoundingSphereRadius()) {
+  const Ogre::VertexData* shared = mesh->sharedVertexData;
+  if(0 == shared || 0 == mesh->getNumSubMeshes())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Reel batch " + name + " needs a mesh with shared vertices", __FILE__);
+  m_instances.reserve(capacity);
+
+  // the mesh's sources as they are, the instance data on the next free one
+  Ogre::VertexData* vd = new Ogre::VertexData();
+  for(const Ogre::VertexElement& element : shared->vertexDeclaration->getElements())
+    vd->vertexDeclaration->addElement(element.getSource(), element.getOffset(), element.getType(),
+      element.getSemantic(), element.getIndex());
+  for(const auto& binding : shared->vertexBufferBinding->getBindings())
+    vd->vertexBufferBinding->setBinding(binding.first, binding.second);
+  vd->vertexStart = shared->vertexStart;
+  vd->vertexCount = shared->vertexCount;
+  const unsigned short source = shared->vertexBufferBinding->getNextIndex();
+  vd->vertexDeclaration->addElement(source, 0, Ogre::VET_FLOAT4, Ogre::VES_TEXTURE_COORDINATES, 1);
+  vd->vertexDeclaration->addElement(source, sizeof(float) * 4, Ogre::VET_FLOAT1, Ogre::VES_TEXTURE_COORDINATES, 2);
+  m_instance_buffer = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(sizeof(instance),
+    capacity, Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+  m_instance_buffer->setIsInstanceData(true);
+  m_instance_buffer->setInstanceDataStepRate(1);
+  vd->vertexBufferBinding->setBinding(source, m_instance_buffer);
+
+  mRenderOp.vertexData = vd;
+  mRenderOp.indexData = mesh->getSubMesh(0)->indexData;
+  mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+  mRenderOp.useIndexes = true;
+  mRenderOp.numberOfInstances = 0;
+  setBoundingBox(Ogre::AxisAlignedBox());
+}
+
+// SimpleRenderable leaves the vertex data to the subclass
+reel_batch::~reel_batch() {
+  delete mRenderOp.vertexData;
+}
+
+// a reel starts at angle 0
+std::size_t reel_batch::add(const Ogre::Vector3& position, const Ogre::Real strip_offset) {
+  if(m_instances.size() >= m_capacity)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Reel batch is full", __FILE__);
+  m_instances.push_back(instance{{float(position.x), float(position.y), float(position.z)}, 0.0f,
+    float(strip_offset)});
+  m_dirty = true;
+  // the mesh is rotated about x, so every reel reaches its radius in y and z
+  const Ogre::Vector3 reach(m_reel_radius, m_reel_radius, m_reel_radius);
+  Ogre::AxisAlignedBox box(getBoundingBox());
+  box.merge(Ogre::AxisAlignedBox(position - reach, position + reach));
+  setBoundingBox(box);
+  if(0 != mParentNode)
+    mParentNode->needUpdate();
+  return m_instances.size() - 1;
+}
+
+void reel_batch::set_angle(const std::size_t reel, const Ogre::Radian& value) {
+  m_instances[reel].m_angle = float(value.valueRadians());
+  m_dirty = true;
+}
+
+void reel_batch::set_strip_offset(const std::size_t reel, const Ogre::Real value) {
+  m_instances[reel].m_strip_offset = float(value);
+  m_dirty = true;
+}
+
+std::size_t reel_batch::size() const {
+  return m_instances.size();
+}
+
+// every viewport queues the batch, the buffer is written for the first one
+void reel_batch::_updateRenderQueue(Ogre::RenderQueue* queue) {
+  if(m_dirty && !m_instances.empty()) {
+    TRACE_ZONE("reel_batch::upload");
+    m_instance_buffer->writeData(0, m_instances.size() * sizeof(instance), m_instances.data(), true);
+    m_dirty = false;
+  }
+  mRenderOp.numberOfInstances = m_instances.size();
+  if(!m_instances.empty())
+    Ogre::SimpleRenderable::_updateRenderQueue(queue);
+}
+
+Ogre::Real reel_batch::getSquaredViewDepth(const Ogre::Camera* camera) const {
+  return getParentNode()->getSquaredViewDepth(camera);
+}
+
+Ogre::Real reel_batch::getBoundingRadius() const {
+  const Ogre::AxisAlignedBox& box = getBoundingBox();
+  if(box.isNull())
+    return 0;
+  return std::max(box.getMinimum().length(), box.getMaximum().length());
+}
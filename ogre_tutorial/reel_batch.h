@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreMesh.h>
+#include <OgreMath.h>
+#include <OgreVector3.h>
+#include <OgreSimpleRenderable.h>
+#include <OgreHardwareVertexBuffer.h>
+
+// Draws every reel of one wheel mesh with a single instanced draw call. The
+// batch shares the mesh's vertex and index buffers and adds a per instance
+// buffer holding position, rotation about the x axis and strip offset of
+// every reel; it is rewritten with discard once per frame if anything changed.
+// The material needs the reel_instanced vertex program, which applies the
+// instance data, and the mesh the float vertex layout. The bounds cover every
+// reel at any angle.
+class reel_batch
+    : public Ogre::SimpleRenderable {
+public:
+  reel_batch(const Ogre::String& name, const Ogre::MeshPtr& mesh, const std::size_t capacity);
+  ~reel_batch();
+  reel_batch(const reel_batch&) = delete;
+  reel_batch& operator=(const reel_batch&) = delete;
+  std::size_t add(const Ogre::Vector3& position, const Ogre::Real strip_offset = 0);
+  void set_angle(const std::size_t reel, const Ogre::Radian& value);
+  void set_strip_offset(const std::size_t reel, const Ogre::Real value);
+  std::size_t size() const;
+  void _updateRenderQueue(Ogre::RenderQueue* queue) override;
+  Ogre::Real getSquaredViewDepth(const Ogre::Camera* camera) const override;
+  Ogre::Real getBoundingRadius() const override;
+private:
+  class instance {
+  public:
+    float m_position[3];
+    float m_angle;
+    float m_strip_offset;
+  };
+private:
+  const Ogre::MeshPtr m_mesh;
+  const std::size_t m_capacity;
+  Ogre::HardwareVertexBufferSharedPtr m_instance_buffer;
+  std::vector<instance> m_instances;
+  bool m_dirty = false;
+  Ogre::Real m_reel_radius;
+};
@@ -0,0 +1,104 @@
+#include <cmath>
+
+#include <OgreException.h>
+#include <OgreMaterialManager.h>
+#include <OgreTechnique.h>
+#include <OgrePass.h>
+#include <OgreTextureUnitState.h>
+#include <OgreGpuProgramParams.h>
+#include <OgreTextureManager.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreResourceGroupManager.h>
+
+#include "trace.h"
+#include "reel_strip.h"
+
+namespace {
+
+  // modulo towards minus infinity, positions run backwards as well
+  std::size_t wrap(const long long value, const std::size_t count) {
+    const long long res = value % static_cast<long long>(count);
+    return res < 0 ? res + count : res;
+  }
+
+} /* namespace */
+
+reel_strip::reel_strip(const std::vector<std::uint8_t>& symbols, const std::size_t stops, const std::size_t window)
+    : m_symbols(symbols)
+    , m_stops(stops, 0)
+    , m_window(window) {
+  if(symbols.empty() || window >= stops)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Reel strip needs symbols and more stops than its window", __FILE__);
+  set_position(0.0);
+}
+
+// the window moves by a stop or two per frame, the rest compares equal
+bool reel_strip::set_position(const double value) {
+  const long long first = static_cast<long long>(std::floor(value - m_window / 2.0));
+  if(first == m_first)
+    return false;
+  m_first = first;
+  bool res = false;
+  for(std::size_t i = 0; i <= m_window; ++i) {
+    std::uint8_t& stop = m_stops[wrap(first + i, m_stops.size())];
+    const std::uint8_t symbol = m_symbols[wrap(first + i, m_symbols.size())];
+    res = res || stop != symbol;
+    stop = symbol;
+  }
+  return res;
+}
+
+std::uint8_t reel_strip::symbol(const double position) const {
+  return m_symbols[wrap(static_cast<long long>(std::floor(position)), m_symbols.size())];
+}
+
+const std::vector<std::uint8_t>& reel_strip::stops() const {
+  return m_stops;
+}
+
+void set_reel_strip_symbols(const Ogre::String& material, const std::vector<Ogre::FloatRect>& rects,
+    const Ogre::String& texture) {
+  if(rects.size() > reel_strip_symbol_count)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Reel strip material " + material + " tells " + std::to_string(reel_strip_symbol_count) + " symbols apart",
+      __FILE__);
+  std::vector<float> values(reel_strip_symbol_count * 4, 0.0f);
+  for(std::size_t i = 0; i < rects.size(); ++i) {
+    values[i * 4] = rects[i].left;
+    values[i * 4 + 1] = rects[i].top;
+    values[i * 4 + 2] = rects[i].right;
+    values[i * 4 + 3] = rects[i].bottom;
+  }
+  // the named constants exist once the programs are loaded
+  Ogre::MaterialPtr res = Ogre::MaterialManager::getSingleton().getByName(material);
+  res->load();
+  Ogre::Pass* pass = res->getTechnique(0)->getPass(0);
+  pass->getFragmentProgramParameters()->setNamedConstant("rects", values.data(), reel_strip_symbol_count, 4);
+  pass->getTextureUnitState(0)->setTextureName(texture);
+}
+
+reel_strip_texture::reel_strip_texture(const Ogre::String& name, const std::size_t stops, const std::size_t rows)
+    : m_stops(stops)
+    , m_rows(rows) {
+  m_texture = Ogre::TextureManager::getSingleton().createManual(name,
+    Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, Ogre::TEX_TYPE_2D, stops, rows, 0, Ogre::PF_L8,
+    Ogre::TU_DYNAMIC_WRITE_ONLY);
+}
+
+reel_strip_texture::~reel_strip_texture() {
+  Ogre::TextureManager::getSingleton().remove(m_texture->getName());
+}
+
+void reel_strip_texture::write(const std::size_t row, const reel_strip& strip) {
+  TRACE_ZONE("reel_strip_texture::write");
+  const std::vector<std::uint8_t>& stops = strip.stops();
+  if(row >= m_rows || stops.size() != m_stops)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Reel strip does not fit the texture", __FILE__);
+  const Ogre::PixelBox source(m_stops, 1, 1, Ogre::PF_L8, const_cast<std::uint8_t*>(stops.data()));
+  m_texture->getBuffer()->blitFromMemory(source, Ogre::Box(0, row, m_stops, row + 1));
+}
+
+Ogre::Real reel_strip_texture::row_coord(const std::size_t row) const {
+  return (row + 0.5f) / m_rows;
+}
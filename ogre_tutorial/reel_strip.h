@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreCommon.h>
+#include <OgreTexture.h>
+
+// Maps a logical reel strip of any length onto the few stops around one
+// physical reel. The position counts stops without wrapping, logical stop k
+// shows symbol k modulo the strip length on the reel's stop k modulo the stop
+// count. Only the window of stops around the one facing the camera is kept
+// current; a stop is rewritten while it is still behind the reel, just before
+// it turns into view. Memory depends on the stop count, not the strip length.
+class reel_strip {
+public:
+  reel_strip(const std::vector<std::uint8_t>& symbols, const std::size_t stops, const std::size_t window);
+  // true if a stop shows another symbol now
+  bool set_position(const double value);
+  std::uint8_t symbol(const double position) const;
+  const std::vector<std::uint8_t>& stops() const;
+private:
+  const std::vector<std::uint8_t> m_symbols;
+  std::vector<std::uint8_t> m_stops;
+  const std::size_t m_window;
+  long long m_first = std::numeric_limits<long long>::min();
+};
+
+// Symbols a reel_strip material can tell apart.
+const std::size_t reel_strip_symbol_count = 64;
+
+// Loads material and points its reel_strip program at the texture rectangle
+// of every symbol index, its first texture at the page holding them all.
+void set_reel_strip_symbols(const Ogre::String& material, const std::vector<Ogre::FloatRect>& rects,
+  const Ogre::String& texture);
+
+// The stops of many reels as symbol indices in an 8 bit texture, one row per
+// reel, sampled without filtering by the reel_strip fragment program. A row
+// is written only when its strip changed, a few bytes per reel and turn.
+class reel_strip_texture {
+public:
+  reel_strip_texture(const Ogre::String& name, const std::size_t stops, const std::size_t rows);
+  ~reel_strip_texture();
+  reel_strip_texture(const reel_strip_texture&) = delete;
+  reel_strip_texture& operator=(const reel_strip_texture&) = delete;
+  void write(const std::size_t row, const reel_strip& strip);
+  // v of the row's texel centres
+  Ogre::Real row_coord(const std::size_t row) const;
+private:
+  Ogre::TexturePtr m_texture;
+  const std::size_t m_stops;
+  const std::size_t m_rows;
+};
@@ -0,0 +1,198 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include <OgreException.h>
+#include <OgreLogManager.h>
+#include <OgreStringConverter.h>
+
+#include "render_system_selector.h"
+
+namespace {
+
+  // frames skipped while shaders compile and textures upload, then measured
+  const std::size_t warmup_frames = 30;
+  const std::size_t measured_frames = 120;
+  const unsigned int max_fsaa = 4;
+
+  const Ogre::ConfigOption* option(Ogre::RenderSystem* render_system, const Ogre::String& name) {
+    Ogre::ConfigOptionMap& options = render_system->getConfigOptions();
+    Ogre::ConfigOptionMap::const_iterator it = options.find(name);
+    return options.end() == it ? 0 : &it->second;
+  }
+
+  bool offers(const Ogre::ConfigOption* value, const Ogre::String& possible) {
+    return 0 != value && value->possibleValues.end() !=
+      std::find(value->possibleValues.begin(), value->possibleValues.end(), possible);
+  }
+
+  unsigned int best_fsaa(Ogre::RenderSystem* render_system, const unsigned int limit) {
+    unsigned int res = 0;
+    if(const Ogre::ConfigOption* value = option(render_system, "FSAA"))
+      for(const Ogre::String& item : value->possibleValues) {
+        const unsigned int samples = Ogre::StringConverter::parseUnsignedInt(item);
+        if(samples <= limit)
+          res = std::max(res, samples);
+      }
+    return res;
+  }
+
+} /* namespace */
+
+render_system_selector::render_system_selector(const Ogre::String& cache_file, const bool benchmark)
+    : m_cache_file(cache_file)
+    , m_benchmark(benchmark) {
+}
+
+Ogre::RenderSystem* render_system_selector::select(const Ogre::RenderSystemList& value, const Ogre::String& forced) {
+  if(value.empty())
+    throw Ogre::Exception(Ogre::Exception::ERR_RENDERINGAPI_ERROR, "Sorry, no rendersystem was found.", __FILE__);
+  m_machine = machine(value);
+  m_candidates.clear();
+  for(Ogre::RenderSystem* item : value)
+    m_candidates.push_back(candidate{item, score(item), -1.0});
+  std::stable_sort(m_candidates.begin(), m_candidates.end(),
+    [](const candidate& a, const candidate& b){ return a.m_score > b.m_score; });
+  load();
+  if(!forced.empty()) {
+    for(const candidate& item : m_candidates)
+      if(forced == item.m_render_system->getName())
+        m_selected = item.m_render_system;
+    if(0 == m_selected)
+      throw Ogre::Exception(Ogre::Exception::ERR_ITEM_NOT_FOUND, "Render system not available: " + forced, __FILE__);
+  }
+  else {
+    const candidate* fastest = 0;
+    const candidate* untested = 0;
+    for(const candidate& item : m_candidates)
+      if(item.m_frame_ms < 0.0) {
+        if(0 == untested)
+          untested = &item;
+      }
+      else if(0 == fastest || item.m_frame_ms < fastest->m_frame_ms)
+        fastest = &item;
+    if(m_benchmark && 0 != untested)
+      m_selected = untested->m_render_system;
+    else
+      m_selected = 0 != fastest ? fastest->m_render_system : m_candidates.front().m_render_system;
+  }
+  m_benchmarking = m_benchmark && std::find_if(m_candidates.begin(), m_candidates.end(),
+    [&](const candidate& item){ return m_selected == item.m_render_system && item.m_frame_ms < 0.0; }) !=
+    m_candidates.end();
+  for(const candidate& item : m_candidates)
+    Ogre::LogManager::getSingleton().logMessage("Render system " + item.m_render_system->getName() +
+      " score " + Ogre::StringConverter::toString(item.m_score) +
+      (item.m_frame_ms < 0.0 ? Ogre::String() : ", " + Ogre::StringConverter::toString(item.m_frame_ms) + " ms/frame") +
+      (m_selected == item.m_render_system ? (m_benchmarking ? " (selected, benchmarking)" : " (selected)") : ""),
+      Ogre::LML_NORMAL);
+  return m_selected;
+}
+
+// Benchmark runs without vsync, otherwise every backend measures the refresh rate.
+Ogre::NameValuePairList render_system_selector::recommended(const Ogre::NameValuePairList& defaults,
+    const bool vsync, const unsigned int fsaa) const {
+  Ogre::NameValuePairList res(defaults);
+  if(0 == m_selected)
+    return res;
+  if(0 != fsaa)
+    res["FSAA"] = Ogre::StringConverter::toString(best_fsaa(m_selected, fsaa));
+  if(vsync) {
+    const bool enabled = !m_benchmarking && offers(option(m_selected, "VSync"), "Yes");
+    res["vsync"] = enabled ? "true" : "false";
+    res["VSync"] = enabled ? "Yes" : "No";
+  }
+  if(offers(option(m_selected, "Colour Depth"), "32"))
+    res["colourDepth"] = "32";
+  return res;
+}
+
+bool render_system_selector::benchmarking() const {
+  return m_benchmarking;
+}
+
+void render_system_selector::frame(const double ms) {
+  if(!m_benchmarking)
+    return;
+  m_samples.push_back(ms);
+  if(m_samples.size() < warmup_frames + measured_frames)
+    return;
+  std::vector<double>::iterator median = m_samples.begin() + warmup_frames + measured_frames / 2;
+  std::nth_element(m_samples.begin() + warmup_frames, median, m_samples.end());
+  for(candidate& item : m_candidates)
+    if(m_selected == item.m_render_system)
+      item.m_frame_ms = *median;
+  m_benchmarking = false;
+  m_samples.clear();
+  Ogre::LogManager::getSingleton().logMessage("Render system benchmark " + m_selected->getName() + ": " +
+    Ogre::StringConverter::toString(*median) + " ms/frame", Ogre::LML_NORMAL);
+  // runs inside a frame, an unwritable cache only costs the next boot a benchmark
+  try {
+    save();
+  }
+  catch(const Ogre::Exception& e) {
+    Ogre::LogManager::getSingleton().logMessage("Render system cache not written: " + e.getDescription(),
+      Ogre::LML_CRITICAL);
+  }
+}
+
+// Modern API first, then whatever the option lists say the driver can do.
+double render_system_selector::score(Ogre::RenderSystem* value) {
+  static const std::pair<const char*, double> api[] = {
+    {"OpenGL 3+ Rendering Subsystem", 40.0},
+    {"Direct3D11 Rendering Subsystem", 40.0},
+    {"OpenGL Rendering Subsystem", 30.0},
+    {"Direct3D9 Rendering Subsystem", 20.0},
+    {"OpenGL ES 2.x Rendering Subsystem", 10.0},
+  };
+  double res = 0.0;
+  for(const std::pair<const char*, double>& item : api)
+    if(item.first == value->getName())
+      res = item.second;
+  res += best_fsaa(value, max_fsaa);
+  if(offers(option(value, "Colour Depth"), "32"))
+    res += 2.0;
+  if(offers(option(value, "RTT Preferred Mode"), "FBO"))
+    res += 2.0;
+  if(offers(option(value, "VSync"), "Yes"))
+    res += 1.0;
+  return res;
+}
+
+Ogre::String render_system_selector::machine(const Ogre::RenderSystemList& value) {
+  char host[256] = {0};
+  if(0 != gethostname(host, sizeof(host) - 1))
+    host[0] = 0;
+  Ogre::String res(host);
+  for(Ogre::RenderSystem* item : value)
+    res += "|" + item->getName();
+  return res;
+}
+
+void render_system_selector::load() {
+  std::ifstream in(m_cache_file.c_str());
+  Ogre::String line;
+  if(!std::getline(in, line) || "machine=" + m_machine != line)
+    return;
+  while(std::getline(in, line)) {
+    const Ogre::String::size_type equal = line.rfind('=');
+    if(Ogre::String::npos == equal)
+      continue;
+    const Ogre::String name = line.substr(0, equal);
+    for(candidate& item : m_candidates)
+      if(name == item.m_render_system->getName())
+        item.m_frame_ms = std::atof(line.substr(equal + 1).c_str());
+  }
+}
+
+void render_system_selector::save() const {
+  std::ofstream out(m_cache_file.c_str(), std::ios::out | std::ios::trunc);
+  if(!out)
+    throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+      "Failed to write render system cache: " + m_cache_file, __FILE__);
+  out << "machine=" << m_machine << '\n';
+  for(const candidate& item : m_candidates)
+    if(item.m_frame_ms >= 0.0)
+      out << item.m_render_system->getName() << '=' << item.m_frame_ms << '\n';
+}
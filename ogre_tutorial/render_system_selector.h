@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreCommon.h>
+#include <OgreRenderSystem.h>
+
+// Picks the render system instead of taking whatever plugin loaded first.
+// Candidates are ranked by what their config options offer. With benchmarking
+// enabled every boot measures the frame time of one untested candidate, once all
+// are measured the fastest one is used. Measurements are cached per machine.
+class render_system_selector {
+public:
+  class candidate {
+  public:
+    Ogre::RenderSystem* m_render_system;
+    double m_score;
+    double m_frame_ms;  // negative until measured
+  };
+public:
+  render_system_selector(const Ogre::String& cache_file, const bool benchmark);
+  Ogre::RenderSystem* select(const Ogre::RenderSystemList& value, const Ogre::String& forced);
+  // vsync and at most fsaa samples where the render system offers them
+  Ogre::NameValuePairList recommended(const Ogre::NameValuePairList& defaults, const bool vsync,
+    const unsigned int fsaa) const;
+  bool benchmarking() const;
+  void frame(const double ms);
+private:
+  static double score(Ogre::RenderSystem* value);
+  static Ogre::String machine(const Ogre::RenderSystemList& value);
+  void load();
+  void save() const;
+private:
+  const Ogre::String m_cache_file;
+  const bool m_benchmark;
+  Ogre::String m_machine;
+  std::vector<candidate> m_candidates;
+  Ogre::RenderSystem* m_selected = 0;
+  bool m_benchmarking = false;
+  std::vector<double> m_samples;
+};
@@ -0,0 +1,245 @@
+#include <fstream>
+#include <set>
+
+#include <OgreConfigFile.h>
+#include <OgreArchive.h>
+#include <OgreException.h>
+#include <OgreLogManager.h>
+
+#include "trace.h"
+#include "resource_index.h"
+#include "resource_groups.h"
+
+resource_groups::resource_groups()
+    : m_worker(&resource_groups::warm_loop, this) {
+  Ogre::ResourceGroupManager::getSingleton().addResourceGroupListener(this);
+  Ogre::ResourceGroupManager::getSingleton().setLoadingListener(this);
+}
+
+resource_groups::~resource_groups() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_jobs.clear();
+  }
+  m_wake.notify_one();
+  m_worker.join();
+  Ogre::ResourceGroupManager& manager = Ogre::ResourceGroupManager::getSingleton();
+  if(this == manager.getLoadingListener())
+    manager.setLoadingListener(0);
+  manager.removeResourceGroupListener(this);
+}
+
+void resource_groups::parse(const Ogre::String& file_name, resource_index* index) {
+  Ogre::ConfigFile config;
+  config.load(file_name);
+  Ogre::ConfigFile::SectionIterator it = config.getSectionIterator();
+  while(it.hasMoreElements()) {
+    const Ogre::String name = it.peekNextKey();
+    const Ogre::ConfigFile::SettingsMultiMap* settings = it.getNext();
+    if(settings->empty())
+      continue;
+    if(0 == m_groups.count(name))
+      m_order.push_back(name);
+    group& value = m_groups[name];
+    for(const std::pair<const Ogre::String, Ogre::String>& item : *settings) {
+      if("Load" == item.first) {
+        if("lazy" != item.second && "eager" != item.second)
+          throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+            "Unknown Load mode '" + item.second + "' in section " + name, __FILE__);
+        value.m_lazy = "lazy" == item.second;
+      }
+      else
+        Ogre::ResourceGroupManager::getSingleton().addResourceLocation(item.second,
+          0 != index ? index->add_location(item.first, item.second, name) : item.first, name);
+    }
+  }
+}
+
+void resource_groups::initialise_eager() {
+  for(const Ogre::String& name : m_order) {
+    group& value = m_groups[name];
+    if(!value.m_lazy)
+      initialise(name, value, false);
+  }
+  // the built-in and autodetect groups are not part of the config
+  Ogre::ResourceGroupManager& manager = Ogre::ResourceGroupManager::getSingleton();
+  for(const Ogre::String& name : manager.getResourceGroups())
+    if(0 == m_groups.count(name) && !manager.isResourceGroupInitialised(name)) {
+      const clock_t::time_point start = clock_t::now();
+      manager.initialiseResourceGroup(name);
+      m_initialised.dispatch(name, start, clock_t::now());
+    }
+}
+
+void resource_groups::require(const Ogre::String& name) {
+  std::map<Ogre::String, group>::iterator it = m_groups.find(name);
+  if(m_groups.end() == it)
+    throw Ogre::Exception(Ogre::Exception::ERR_ITEM_NOT_FOUND, "Unknown resource group " + name, __FILE__);
+  if(gs_ready != it->second.m_state)
+    initialise(it->first, it->second, false);
+}
+
+void resource_groups::prefetch(const Ogre::String& name) {
+  std::map<Ogre::String, group>::iterator it = m_groups.find(name);
+  if(m_groups.end() == it)
+    throw Ogre::Exception(Ogre::Exception::ERR_ITEM_NOT_FOUND, "Unknown resource group " + name, __FILE__);
+  if(gs_declared != it->second.m_state)
+    return;
+  job value;
+  value.m_group = name;
+  std::set<Ogre::String> archives;
+  Ogre::FileInfoListPtr files = Ogre::ResourceGroupManager::getSingleton().listResourceFileInfo(name);
+  for(const Ogre::FileInfo& file : *files) {
+    // a zip is read whole, a directory file by file
+    if(Ogre::StringUtil::endsWith(file.archive->getType(), "zip")) {
+      if(archives.insert(file.archive->getName()).second)
+        value.m_files.push_back(file.archive->getName());
+    }
+    else
+      value.m_files.push_back(file.archive->getName() + "/" + file.filename);
+  }
+  it->second.m_state = gs_warming;
+  progress(name, st_warming, 0, value.m_files.size());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(value));
+  }
+  m_wake.notify_one();
+}
+
+bool resource_groups::ready(const Ogre::String& name) const {
+  std::map<Ogre::String, group>::const_iterator it = m_groups.find(name);
+  return m_groups.end() != it && gs_ready == it->second.m_state;
+}
+
+// finishes at most one warmed group per call to bound the frame cost
+void resource_groups::update() {
+  Ogre::String name;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_warmed.empty())
+      return;
+    name = m_warmed.front();
+    m_warmed.erase(m_warmed.begin());
+  }
+  group& value = m_groups[name];
+  if(gs_ready == value.m_state)
+    return;
+  value.m_state = gs_warm;
+  TRACE_ZONE("resource_groups::update");
+  initialise(name, value, true);
+}
+
+resource_groups::progress_event_t& resource_groups::get_progress() {
+  return m_progress;
+}
+
+resource_groups::initialised_event_t& resource_groups::get_initialised() {
+  return m_initialised;
+}
+
+void resource_groups::resourceGroupScriptingStarted(const Ogre::String& group, size_t count) {
+  m_current = group;
+  m_done = 0;
+  m_total = count;
+  progress(m_current, st_parsing, m_done, m_total);
+}
+
+void resource_groups::scriptParseStarted(const Ogre::String& script, bool& skip) {
+}
+
+void resource_groups::scriptParseEnded(const Ogre::String& script, bool skipped) {
+  progress(m_current, st_parsing, ++m_done, m_total);
+}
+
+void resource_groups::resourceGroupScriptingEnded(const Ogre::String& group) {
+}
+
+void resource_groups::resourceGroupLoadStarted(const Ogre::String& group, size_t count) {
+  m_current = group;
+  m_done = 0;
+  m_total = count;
+  progress(m_current, st_loading, m_done, m_total);
+}
+
+void resource_groups::resourceLoadStarted(const Ogre::ResourcePtr& resource) {
+}
+
+void resource_groups::resourceLoadEnded() {
+  progress(m_current, st_loading, ++m_done, m_total);
+}
+
+void resource_groups::worldGeometryStageStarted(const Ogre::String& description) {
+}
+
+void resource_groups::worldGeometryStageEnded() {
+}
+
+void resource_groups::resourceGroupLoadEnded(const Ogre::String& group) {
+}
+
+// First use of a lazy group: parse its scripts before the resource is opened so
+// materials referenced by a mesh already exist when the mesh is attached.
+Ogre::DataStreamPtr resource_groups::resourceLoading(const Ogre::String& name, const Ogre::String& group,
+    Ogre::Resource* resource) {
+  std::map<Ogre::String, resource_groups::group>::iterator it = m_groups.find(group);
+  if(m_groups.end() != it && gs_ready != it->second.m_state) {
+    Ogre::LogManager::getSingleton().logMessage("Resource group " + group + " initialised on first use by " + name,
+      Ogre::LML_NORMAL);
+    initialise(it->first, it->second, false);
+  }
+  return Ogre::DataStreamPtr();
+}
+
+void resource_groups::resourceStreamOpened(const Ogre::String& name, const Ogre::String& group,
+    Ogre::Resource* resource, Ogre::DataStreamPtr& stream) {
+}
+
+bool resource_groups::resourceCollision(Ogre::Resource* resource, Ogre::ResourceManager* manager) {
+  // keep Ogre's duplicate resource exception
+  return false;
+}
+
+void resource_groups::initialise(const Ogre::String& name, group& value, const bool load) {
+  // set before initialising, a script may load a resource of the same group
+  value.m_state = gs_ready;
+  const clock_t::time_point start = clock_t::now();
+  Ogre::ResourceGroupManager& manager = Ogre::ResourceGroupManager::getSingleton();
+  if(!manager.isResourceGroupInitialised(name))
+    manager.initialiseResourceGroup(name);
+  if(load && !manager.isResourceGroupLoaded(name))
+    manager.loadResourceGroup(name);
+  m_initialised.dispatch(name, start, clock_t::now());
+  progress(name, st_ready, 1, 1);
+}
+
+void resource_groups::progress(const Ogre::String& name, const stage value, const std::size_t done,
+    const std::size_t total) {
+  if(m_groups.count(name))
+    m_progress.dispatch(name, value, done, total);
+}
+
+void resource_groups::warm_loop() {
+  tracer::set_thread_name("resource_warm");
+  std::vector<char> buffer(1 << 16);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(true) {
+    m_wake.wait(lock, [&](){ return !m_running || !m_jobs.empty(); });
+    if(!m_running)
+      break;
+    job value = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    lock.unlock();
+    {
+      TRACE_ZONE("resource_groups::warm");
+      for(std::size_t i = 0; i < value.m_files.size() && m_running; ++i) {
+        std::ifstream in(value.m_files[i].c_str(), std::ios::in | std::ios::binary);
+        while(in.read(&buffer[0], buffer.size()) || 0 != in.gcount())
+          ;
+      }
+    }
+    lock.lock();
+    m_warmed.push_back(value.m_group);
+  }
+}
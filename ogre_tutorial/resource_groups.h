@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreResourceGroupManager.h>
+
+#include "listener_registry.h"
+
+class resource_index;
+
+// Resource groups declared in a resources config. Every location is registered
+// up front so Ogre can find any resource, but only eager groups are initialised
+// at startup. A section containing `Load=lazy` is initialised on its first
+// resource load, by require() or in the background by prefetch(): a worker
+// thread reads the group files into the page cache and update() initialises and
+// loads the group on the render thread. Progress is reported on the render thread.
+// Only resources opened through the ResourceGroupManager count as a first load;
+// particle templates, compositors and other script definitions are looked up
+// by name, so a lazy group holding them needs require() before the lookup.
+// Eager groups are initialised in the order of the config file.
+class resource_groups
+    : public Ogre::ResourceGroupListener
+    , public Ogre::ResourceLoadingListener {
+public:
+  enum stage { st_warming, st_parsing, st_loading, st_ready };
+  using progress_event_t = listener_registry<bool(const Ogre::String&, const stage, const std::size_t, const std::size_t)>;
+  using clock_t = std::chrono::steady_clock;
+  using initialised_event_t = listener_registry<bool(const Ogre::String&, const clock_t::time_point&,
+    const clock_t::time_point&)>;
+public:
+  resource_groups();
+  ~resource_groups();
+  resource_groups(const resource_groups&) = delete;
+  resource_groups& operator=(const resource_groups&) = delete;
+  // with an index, FileSystem and Zip locations are added through it
+  void parse(const Ogre::String& file_name, resource_index* index = 0);
+  void initialise_eager();
+  void require(const Ogre::String& group);
+  void prefetch(const Ogre::String& group);
+  bool ready(const Ogre::String& group) const;
+  void update();
+  progress_event_t& get_progress();
+  initialised_event_t& get_initialised();
+  // Ogre::ResourceGroupListener
+  void resourceGroupScriptingStarted(const Ogre::String& group, size_t count) override;
+  void scriptParseStarted(const Ogre::String& script, bool& skip) override;
+  void scriptParseEnded(const Ogre::String& script, bool skipped) override;
+  void resourceGroupScriptingEnded(const Ogre::String& group) override;
+  void resourceGroupLoadStarted(const Ogre::String& group, size_t count) override;
+  void resourceLoadStarted(const Ogre::ResourcePtr& resource) override;
+  void resourceLoadEnded() override;
+  void worldGeometryStageStarted(const Ogre::String& description) override;
+  void worldGeometryStageEnded() override;
+  void resourceGroupLoadEnded(const Ogre::String& group) override;
+  // Ogre::ResourceLoadingListener
+  Ogre::DataStreamPtr resourceLoading(const Ogre::String& name, const Ogre::String& group,
+    Ogre::Resource* resource) override;
+  void resourceStreamOpened(const Ogre::String& name, const Ogre::String& group,
+    Ogre::Resource* resource, Ogre::DataStreamPtr& stream) override;
+  bool resourceCollision(Ogre::Resource* resource, Ogre::ResourceManager* manager) override;
+private:
+  enum state { gs_declared, gs_warming, gs_warm, gs_ready };
+  class group {
+  public:
+    bool m_lazy = false;
+    state m_state = gs_declared;
+  };
+  class job {
+  public:
+    Ogre::String m_group;
+    std::vector<Ogre::String> m_files;
+  };
+private:
+  void initialise(const Ogre::String& name, group& value, const bool load);
+  void progress(const Ogre::String& name, const stage value, const std::size_t done, const std::size_t total);
+  void warm_loop();
+private:
+  std::map<Ogre::String, group> m_groups;
+  std::vector<Ogre::String> m_order;  // as declared in the config
+  progress_event_t m_progress;
+  initialised_event_t m_initialised;
+  Ogre::String m_current;
+  std::size_t m_done = 0;
+  std::size_t m_total = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<job> m_jobs;
+  std::vector<Ogre::String> m_warmed;
+  std::atomic<bool> m_running{true};
+  std::thread m_worker;
+};
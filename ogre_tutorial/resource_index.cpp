@@ -0,0 +1,479 @@
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include <OgreArchive.h>
+#include <OgreArchiveFactory.h>
+#include <OgreArchiveManager.h>
+#include <OgreException.h>
+#include <OgreFileSystem.h>
+#include <OgreLogManager.h>
+#include <OgreStringConverter.h>
+#include <OgreZip.h>
+
+#include "trace.h"
+#include "resource_index.h"
+
+namespace {
+
+  const char magic[4] = {'O', 'R', 'I', 'X'};
+  const std::uint32_t version = 2;
+
+  // prefix of the caching archive types, Ogre's own keep their names
+  const char cached_prefix[] = "Cached";
+
+  const std::uint32_t zip_end_signature = 0x06054b50;
+  const std::uint32_t zip_entry_signature = 0x02014b50;
+
+  std::uint32_t get_u16(const unsigned char* value) {
+    return value[0] | value[1] << 8;
+  }
+
+  std::uint32_t get_u32(const unsigned char* value) {
+    return get_u16(value) | static_cast<std::uint32_t>(get_u16(value + 2)) << 16;
+  }
+
+  void write_u64(std::ostream& out, const std::uint64_t value) {
+    unsigned char data[8];
+    for(std::size_t i = 0; i < sizeof(data); ++i)
+      data[i] = static_cast<unsigned char>(value >> i * 8);
+    out.write(reinterpret_cast<const char*>(data), sizeof(data));
+  }
+
+  void write_string(std::ostream& out, const Ogre::String& value) {
+    write_u64(out, value.size());
+    out.write(value.data(), value.size());
+  }
+
+  std::uint64_t read_u64(std::istream& in) {
+    unsigned char data[8] = {0};
+    in.read(reinterpret_cast<char*>(data), sizeof(data));
+    std::uint64_t res = 0;
+    for(std::size_t i = 0; i < sizeof(data); ++i)
+      res |= static_cast<std::uint64_t>(data[i]) << i * 8;
+    return res;
+  }
+
+  Ogre::String read_string(std::istream& in) {
+    const std::uint64_t size = read_u64(in);
+    if(!in || size > 1 << 16) {
+      in.setstate(std::ios::failbit);
+      return Ogre::String();
+    }
+    Ogre::String res(static_cast<std::size_t>(size), '\0');
+    in.read(&res[0], res.size());
+    return res;
+  }
+
+  Ogre::String key(const Ogre::String& type, const Ogre::String& name) {
+    return type + '|' + name;
+  }
+
+  // Answers listings from the index and defers opening the real archive, a zip
+  // is only parsed by zziplib when one of its files is read. The index knows
+  // the location by the type of the real archive.
+  class cached_archive : public Ogre::Archive {
+  public:
+    cached_archive(resource_index& index, Ogre::ArchiveFactory& factory, const Ogre::String& name,
+        const Ogre::String& type, const bool read_only)
+      : Ogre::Archive(name, type)
+      , m_index(index)
+      , m_factory(factory) {
+      mReadOnly = read_only;
+    }
+    ~cached_archive() {
+      unload();
+    }
+    bool isCaseSensitive() const override {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+      return false;
+#else
+      return "Zip" != m_factory.getType();
+#endif
+    }
+    void load() override {
+      m_index.get(m_factory.getType(), mName, false);
+    }
+    void unload() override {
+      if(0 != m_real) {
+        m_real->unload();
+        m_factory.destroyInstance(m_real);
+        m_real = 0;
+      }
+    }
+    Ogre::DataStreamPtr open(const Ogre::String& filename, bool readOnly) const override {
+      return real().open(filename, readOnly);
+    }
+    Ogre::DataStreamPtr create(const Ogre::String& filename) const override {
+      Ogre::DataStreamPtr res = real().create(filename);
+      m_index.invalidate(m_factory.getType(), mName);
+      return res;
+    }
+    void remove(const Ogre::String& filename) const override {
+      real().remove(filename);
+      m_index.invalidate(m_factory.getType(), mName);
+    }
+    Ogre::StringVectorPtr list(bool recursive, bool dirs) override {
+      return find("*", recursive, dirs);
+    }
+    Ogre::FileInfoListPtr listFileInfo(bool recursive, bool dirs) override {
+      return findFileInfo("*", recursive, dirs);
+    }
+    Ogre::StringVectorPtr find(const Ogre::String& pattern, bool recursive, bool dirs) override {
+      Ogre::StringVectorPtr res(OGRE_NEW_T(Ogre::StringVector, Ogre::MEMCATEGORY_GENERAL)(),
+        Ogre::SPFM_DELETE_T);
+      const bool full_match = Ogre::String::npos != pattern.find_first_of("/\\");
+      for(const resource_index::entry& value : m_index.get(m_factory.getType(), mName, recursive).m_entries)
+        if(matches(value, pattern, full_match, recursive, dirs))
+          res->push_back(value.m_filename);
+      return res;
+    }
+    bool exists(const Ogre::String& filename) override {
+      const bool case_sensitive = isCaseSensitive();
+      for(const resource_index::entry& value : m_index.get(m_factory.getType(), mName, false).m_entries)
+        if(!value.m_dir && (case_sensitive ? filename == value.m_filename :
+            Ogre::StringUtil::match(value.m_filename, filename, false)))
+          return true;
+      return false;
+    }
+    time_t getModifiedTime(const Ogre::String& filename) override {
+      resource_index::stamp value;
+      resource_index::make_stamp("Zip" == m_factory.getType() ? mName : mName + "/" + filename, value);
+      return static_cast<time_t>(value.m_mtime / 1000000000);
+    }
+    Ogre::FileInfoListPtr findFileInfo(const Ogre::String& pattern, bool recursive, bool dirs) const override {
+      Ogre::FileInfoListPtr res(OGRE_NEW_T(Ogre::FileInfoList, Ogre::MEMCATEGORY_GENERAL)(),
+        Ogre::SPFM_DELETE_T);
+      const bool full_match = Ogre::String::npos != pattern.find_first_of("/\\");
+      for(const resource_index::entry& value : m_index.get(m_factory.getType(), mName, recursive).m_entries)
+        if(matches(value, pattern, full_match, recursive, dirs)) {
+          Ogre::FileInfo info;
+          info.archive = this;
+          info.filename = value.m_filename;
+          info.path = value.m_path;
+          info.basename = value.m_basename;
+          info.compressedSize = static_cast<size_t>(value.m_compressed);
+          info.uncompressedSize = static_cast<size_t>(value.m_uncompressed);
+          res->push_back(info);
+        }
+      return res;
+    }
+  private:
+    Ogre::Archive& real() const {
+      if(0 == m_real) {
+        TRACE_ZONE("cached_archive::real");
+        m_real = m_factory.createInstance(mName, mReadOnly);
+        m_real->load();
+      }
+      return *m_real;
+    }
+    bool matches(const resource_index::entry& value, const Ogre::String& pattern, const bool full_match,
+        const bool recursive, const bool dirs) const {
+      if(dirs != value.m_dir || (!recursive && !full_match && !value.m_path.empty()))
+        return false;
+      return Ogre::StringUtil::match(full_match ? value.m_filename : value.m_basename, pattern,
+        isCaseSensitive());
+    }
+  private:
+    resource_index& m_index;
+    Ogre::ArchiveFactory& m_factory;
+    mutable Ogre::Archive* m_real = 0;
+  };
+
+  template<typename Factory>
+  class cached_archive_factory : public Ogre::ArchiveFactory {
+  public:
+    explicit cached_archive_factory(resource_index& index)
+      : m_index(index)
+      , m_type(cached_prefix + m_factory.getType()) {
+    }
+    const Ogre::String& getType() const override {
+      return m_type;
+    }
+    Ogre::Archive* createInstance(const Ogre::String& name, bool readOnly) override {
+      return OGRE_NEW cached_archive(m_index, m_factory, name, m_type, readOnly);
+    }
+    void destroyInstance(Ogre::Archive* value) override {
+      OGRE_DELETE value;
+    }
+  private:
+    resource_index& m_index;
+    Factory m_factory;
+    const Ogre::String m_type;
+  };
+
+} /* namespace */
+
+resource_index::resource_index(const Ogre::String& file_name)
+    : m_file_name(file_name) {
+  load();
+}
+
+resource_index::~resource_index() {
+  try {
+    save();
+  }
+  catch(const std::exception&) {
+  }
+}
+
+// Must be called after Ogre::Root is created and before any resource location
+// is added; the factories have to outlive Ogre::Root. Root has registered
+// FileSystem and Zip already and addArchiveFactory() keeps the first factory of
+// a type, so these go in under their own names.
+void resource_index::install() {
+  m_factories.emplace_back(new cached_archive_factory<Ogre::FileSystemArchiveFactory>(*this));
+  m_factories.emplace_back(new cached_archive_factory<Ogre::ZipArchiveFactory>(*this));
+  for(const std::unique_ptr<Ogre::ArchiveFactory>& value : m_factories)
+    Ogre::ArchiveManager::getSingleton().addArchiveFactory(value.get());
+}
+
+// The first call for a location in this run drops the groups of the last one.
+Ogre::String resource_index::add_location(const Ogre::String& type, const Ogre::String& name,
+    const Ogre::String& group) {
+  if(m_factories.empty() || ("FileSystem" != type && "Zip" != type))
+    return type;
+  location& value = m_locations[key(type, name)];
+  std::vector<Ogre::String> groups;
+  if(value.m_added)
+    groups = value.m_groups;
+  if(groups.end() == std::find(groups.begin(), groups.end(), group))
+    groups.push_back(group);
+  if(groups != value.m_groups) {
+    value.m_groups.swap(groups);
+    m_dirty = true;
+  }
+  value.m_added = true;
+  return cached_prefix + type;
+}
+
+void resource_index::save() {
+  if(!m_dirty || m_file_name.empty())
+    return;
+  const Ogre::String temporary = m_file_name + ".tmp";
+  {
+    std::ofstream out(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!out)
+      throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+        "Failed to open resource index: " + temporary, __FILE__);
+    out.write(magic, sizeof(magic));
+    write_u64(out, version);
+    write_u64(out, m_locations.size());
+    for(const std::pair<const Ogre::String, location>& item : m_locations) {
+      write_string(out, item.first);
+      write_u64(out, item.second.m_recursive);
+      write_u64(out, item.second.m_groups.size());
+      for(const Ogre::String& value : item.second.m_groups)
+        write_string(out, value);
+      write_u64(out, item.second.m_stamps.size());
+      for(const stamp& value : item.second.m_stamps) {
+        write_string(out, value.m_path);
+        write_u64(out, static_cast<std::uint64_t>(value.m_mtime));
+        write_u64(out, value.m_size);
+      }
+      write_u64(out, item.second.m_entries.size());
+      for(const entry& value : item.second.m_entries) {
+        write_string(out, value.m_filename);
+        write_string(out, value.m_path);
+        write_string(out, value.m_basename);
+        write_u64(out, value.m_compressed);
+        write_u64(out, value.m_uncompressed);
+        write_u64(out, value.m_offset);
+        write_u64(out, value.m_dir);
+      }
+    }
+    if(!out)
+      throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+        "Failed to write resource index: " + temporary, __FILE__);
+  }
+  std::remove(m_file_name.c_str());
+  if(0 != std::rename(temporary.c_str(), m_file_name.c_str()))
+    throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+      "Failed to replace resource index: " + m_file_name, __FILE__);
+  if(0 != Ogre::LogManager::getSingletonPtr())
+    Ogre::LogManager::getSingleton().logMessage("Resource index: " + Ogre::StringConverter::toString(m_hits) +
+      " locations reused, " + Ogre::StringConverter::toString(m_scans) + " scanned", Ogre::LML_NORMAL);
+  m_dirty = false;
+}
+
+const resource_index::location& resource_index::get(const Ogre::String& type, const Ogre::String& name,
+    const bool recursive) {
+  const std::pair<std::map<Ogre::String, location>::iterator, bool> it =
+    m_locations.insert(std::make_pair(key(type, name), location()));
+  location& value = it.first->second;
+  if(value.m_checked && (value.m_recursive || !recursive))
+    return value;
+  if(!it.second && valid(value, recursive)) {
+    ++m_hits;
+    value.m_checked = true;
+    return value;
+  }
+  TRACE_ZONE("resource_index::scan");
+  ++m_scans;
+  location current;
+  current.m_groups.swap(value.m_groups);
+  current.m_added = value.m_added;
+  value = std::move(current);
+  if("Zip" == type)
+    scan_zip(name, value);
+  else
+    scan_file_system(name, recursive, value);
+  value.m_checked = true;
+  m_dirty = true;
+  return value;
+}
+
+void resource_index::invalidate(const Ogre::String& type, const Ogre::String& name) {
+  std::map<Ogre::String, location>::iterator it = m_locations.find(key(type, name));
+  if(m_locations.end() != it) {
+    it->second.m_stamps.clear();
+    it->second.m_checked = false;
+    m_dirty = true;
+  }
+}
+
+bool resource_index::make_stamp(const Ogre::String& path, stamp& value) {
+  struct stat info;
+  if(0 != ::stat(path.c_str(), &info))
+    return false;
+  value.m_path = path;
+  // whole seconds miss a file rewritten right after it was scanned
+#if OGRE_PLATFORM == OGRE_PLATFORM_LINUX || OGRE_PLATFORM == OGRE_PLATFORM_ANDROID
+  value.m_mtime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#elif OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+  value.m_mtime = static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+  value.m_mtime = static_cast<std::int64_t>(info.st_mtime) * 1000000000;
+#endif
+  value.m_size = static_cast<std::uint64_t>(info.st_size);
+  return true;
+}
+
+bool resource_index::valid(const location& value, const bool recursive) const {
+  if(value.m_stamps.empty() || (recursive && !value.m_recursive))
+    return false;
+  stamp current;
+  for(const stamp& item : value.m_stamps)
+    if(!make_stamp(item.m_path, current) || current.m_mtime != item.m_mtime || current.m_size != item.m_size)
+      return false;
+  return true;
+}
+
+// Reads the central directory directly, it has everything the listing needs.
+void resource_index::scan_zip(const Ogre::String& name, location& value) const {
+  stamp archive;
+  if(!make_stamp(name, archive))
+    throw Ogre::Exception(Ogre::Exception::ERR_FILE_NOT_FOUND, "Zip archive not found: " + name, __FILE__);
+  value.m_recursive = true;
+  value.m_stamps.push_back(archive);
+  std::ifstream in(name.c_str(), std::ios::in | std::ios::binary);
+  const std::uint64_t tail = std::min<std::uint64_t>(archive.m_size, 22 + 0xffff);
+  std::vector<unsigned char> buffer(static_cast<std::size_t>(tail));
+  in.seekg(static_cast<std::streamoff>(archive.m_size - tail));
+  in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  std::size_t end = buffer.size() < 22 ? 0 : buffer.size() - 22 + 1;
+  while(0 != end && zip_end_signature != get_u32(&buffer[end - 1]))
+    --end;
+  if(!in || 0 == end)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Not a zip archive: " + name, __FILE__);
+  const unsigned char* record = &buffer[end - 1];
+  const std::uint32_t count = get_u16(record + 10);
+  const std::uint32_t size = get_u32(record + 12);
+  const std::uint32_t offset = get_u32(record + 16);
+  buffer.resize(size);
+  in.seekg(offset);
+  in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  if(!in)
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Broken zip central directory: " + name, __FILE__);
+  value.m_entries.reserve(count);
+  for(std::size_t pos = 0, i = 0; i < count && pos + 46 <= buffer.size(); ++i) {
+    const unsigned char* header = &buffer[pos];
+    if(zip_entry_signature != get_u32(header))
+      break;
+    const std::size_t name_size = get_u16(header + 28);
+    const std::size_t next = pos + 46 + name_size + get_u16(header + 30) + get_u16(header + 32);
+    if(next > buffer.size())
+      break;
+    entry item;
+    item.m_filename.assign(reinterpret_cast<const char*>(header + 46), name_size);
+    item.m_uncompressed = get_u32(header + 24);
+    item.m_offset = get_u32(header + 42);
+    // same conventions as Ogre::ZipArchive: no trailing slash, size_t(-1) for folders
+    item.m_dir = !item.m_filename.empty() && '/' == item.m_filename.back();
+    if(item.m_dir)
+      item.m_filename.pop_back();
+    Ogre::StringUtil::splitFilename(item.m_filename, item.m_basename, item.m_path);
+    item.m_compressed = item.m_dir ? std::numeric_limits<size_t>::max() : get_u32(header + 20);
+    value.m_entries.push_back(item);
+    pos = next;
+  }
+}
+
+void resource_index::scan_file_system(const Ogre::String& name, const bool recursive, location& value) const {
+  Ogre::FileSystemArchiveFactory factory;
+  Ogre::Archive* archive = factory.createInstance(name, true);
+  archive->load();
+  stamp root;
+  if(make_stamp(name, root))
+    value.m_stamps.push_back(root);
+  value.m_recursive = recursive;
+  for(const bool dirs : {false, true}) {
+    Ogre::FileInfoListPtr files = archive->listFileInfo(recursive, dirs);
+    for(const Ogre::FileInfo& info : *files) {
+      entry item;
+      item.m_filename = info.filename;
+      item.m_path = info.path;
+      item.m_basename = info.basename;
+      item.m_compressed = info.compressedSize;
+      item.m_uncompressed = info.uncompressedSize;
+      item.m_dir = dirs;
+      value.m_entries.push_back(item);
+      // a directory changes when a file is added or removed, a file when it is edited in place
+      stamp current;
+      if((!dirs || recursive) && make_stamp(name + "/" + info.filename, current))
+        value.m_stamps.push_back(current);
+    }
+  }
+  archive->unload();
+  factory.destroyInstance(archive);
+}
+
+void resource_index::load() {
+  std::ifstream in(m_file_name.c_str(), std::ios::in | std::ios::binary);
+  char header[sizeof(magic)] = {0};
+  if(!in.read(header, sizeof(header)) || !std::equal(header, header + sizeof(header), magic) ||
+      version != read_u64(in))
+    return;
+  std::map<Ogre::String, location> locations;
+  for(std::uint64_t i = 0, count = read_u64(in); in && i < count; ++i) {
+    const Ogre::String name = read_string(in);
+    location& value = locations[name];
+    value.m_recursive = 0 != read_u64(in);
+    for(std::uint64_t j = 0, groups = read_u64(in); in && j < groups; ++j)
+      value.m_groups.push_back(read_string(in));
+    for(std::uint64_t j = 0, stamps = read_u64(in); in && j < stamps; ++j) {
+      stamp item;
+      item.m_path = read_string(in);
+      item.m_mtime = static_cast<std::int64_t>(read_u64(in));
+      item.m_size = read_u64(in);
+      value.m_stamps.push_back(item);
+    }
+    for(std::uint64_t j = 0, entries = read_u64(in); in && j < entries; ++j) {
+      entry item;
+      item.m_filename = read_string(in);
+      item.m_path = read_string(in);
+      item.m_basename = read_string(in);
+      item.m_compressed = read_u64(in);
+      item.m_uncompressed = read_u64(in);
+      item.m_offset = read_u64(in);
+      item.m_dir = 0 != read_u64(in);
+      value.m_entries.push_back(item);
+    }
+  }
+  // a truncated file is ignored as a whole, every location is rescanned
+  if(in)
+    m_locations.swap(locations);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <OgreString.h>
+
+namespace Ogre {
+  class ArchiveFactory;
+}
+
+// Persistent listing of every FileSystem and Zip resource location. install()
+// registers caching archive factories next to Ogre's, as CachedFileSystem and
+// CachedZip; a location added through add_location() uses them, answers
+// list/find from this index and only opens the real archive when a file is
+// read. A location is rescanned when the mtime or size of the zip, or of any
+// scanned directory or file, has changed; the other locations keep their
+// cached listing. The groups a location was added to are stored with it.
+class resource_index {
+public:
+  class entry {
+  public:
+    Ogre::String m_filename;
+    Ogre::String m_path;
+    Ogre::String m_basename;
+    std::uint64_t m_compressed = 0;
+    std::uint64_t m_uncompressed = 0;
+    std::uint64_t m_offset = 0;  // local header offset inside a zip
+    bool m_dir = false;
+  };
+  class stamp {
+  public:
+    Ogre::String m_path;
+    std::int64_t m_mtime = 0;  // nanoseconds where the platform has them
+    std::uint64_t m_size = 0;
+  };
+  class location {
+  public:
+    bool m_recursive = false;
+    bool m_checked = false;  // stamps compared in this run
+    bool m_added = false;  // add_location() called in this run
+    std::vector<stamp> m_stamps;
+    std::vector<entry> m_entries;
+    std::vector<Ogre::String> m_groups;
+  };
+public:
+  explicit resource_index(const Ogre::String& file_name);
+  ~resource_index();
+  resource_index(const resource_index&) = delete;
+  resource_index& operator=(const resource_index&) = delete;
+  void install();
+  // records the group and returns the archive type to add the location with
+  Ogre::String add_location(const Ogre::String& type, const Ogre::String& name, const Ogre::String& group);
+  void save();
+  const location& get(const Ogre::String& type, const Ogre::String& name, const bool recursive);
+  void invalidate(const Ogre::String& type, const Ogre::String& name);
+  static bool make_stamp(const Ogre::String& path, stamp& value);
+private:
+  bool valid(const location& value, const bool recursive) const;
+  void scan_zip(const Ogre::String& name, location& value) const;
+  void scan_file_system(const Ogre::String& name, const bool recursive, location& value) const;
+  void load();
+private:
+  const Ogre::String m_file_name;
+  std::map<Ogre::String, location> m_locations;
+  std::vector<std::unique_ptr<Ogre::ArchiveFactory>> m_factories;
+  unsigned int m_hits = 0;
+  unsigned int m_scans = 0;
+  bool m_dirty = false;
+};
@@ -0,0 +1,53 @@
+#include <cstdint>
+
+#include "scratch_arena.h"
+
+scratch_arena::marker::marker(scratch_arena& arena)
+    : m_arena(arena)
+    , m_block(arena.m_current)
+    , m_used(arena.m_used) {
+}
+
+scratch_arena::marker::~marker() {
+  m_arena.m_current = m_block;
+  m_arena.m_used = m_used;
+}
+
+scratch_arena::scratch_arena(const std::size_t block_size)
+    : m_block_size(block_size) {
+}
+
+// Blocks after the current one are free. A request that does not fit moves on
+// to the next free block large enough, or appends a new one.
+void* scratch_arena::allocate(const std::size_t size, const std::size_t alignment) {
+  for(; m_current < m_blocks.size(); ++m_current, m_used = 0) {
+    block& value = m_blocks[m_current];
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(value.m_data.get());
+    const std::uintptr_t start = (base + m_used + alignment - 1) & ~std::uintptr_t(alignment - 1);
+    if(start + size <= base + value.m_size) {
+      m_used = start + size - base;
+      return reinterpret_cast<void*>(start);
+    }
+  }
+  const std::size_t block_size = size + alignment > m_block_size ? size + alignment : m_block_size;
+  m_blocks.push_back(block{std::unique_ptr<unsigned char[]>(new unsigned char[block_size]), block_size});
+  m_used = 0;
+  return allocate(size, alignment);
+}
+
+void scratch_arena::reset() {
+  m_current = 0;
+  m_used = 0;
+}
+
+std::size_t scratch_arena::capacity() const {
+  std::size_t res = 0;
+  for(const block& value : m_blocks)
+    res += value.m_size;
+  return res;
+}
+
+scratch_arena& scratch_arena::for_thread() {
+  static thread_local scratch_arena res;
+  return res;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for temporary generation data that is too large for the
+// stack. Memory comes from blocks which stay allocated when the arena is
+// rewound, so generating the same meshes again allocates nothing. A marker
+// rewinds everything allocated after it was taken. Only trivially destructible
+// types belong in here, nothing is constructed or destroyed.
+class scratch_arena {
+public:
+  class marker {
+  public:
+    explicit marker(scratch_arena& arena);
+    ~marker();
+    marker(const marker&) = delete;
+    marker& operator=(const marker&) = delete;
+  private:
+    scratch_arena& m_arena;
+    const std::size_t m_block;
+    const std::size_t m_used;
+  };
+public:
+  explicit scratch_arena(const std::size_t block_size = 1 << 20);
+  scratch_arena(const scratch_arena&) = delete;
+  scratch_arena& operator=(const scratch_arena&) = delete;
+  void* allocate(const std::size_t size, const std::size_t alignment);
+  template<typename T>
+  T* allocate(const std::size_t count) {
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+  }
+  void reset();
+  std::size_t capacity() const;
+  static scratch_arena& for_thread();
+private:
+  class block {
+  public:
+    std::unique_ptr<unsigned char[]> m_data;
+    std::size_t m_size;
+  };
+private:
+  const std::size_t m_block_size;
+  std::vector<block> m_blocks;
+  std::size_t m_current = 0;
+  std::size_t m_used = 0;
+};
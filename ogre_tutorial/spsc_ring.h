@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single producer / single consumer queue. push() and pop() never block
+// and never allocate, size must be a power of two.
+template<typename T, std::size_t N>
+class spsc_ring {
+  static_assert(0 != N && 0 == (N & (N - 1)), "spsc_ring size must be a power of two");
+public:
+  static const std::size_t capacity = N;
+public:
+  bool push(const T& value) {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if(N == head - m_tail.load(std::memory_order_acquire))
+      return false;
+    m_data[head & (N - 1)] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  bool pop(T& value) {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if(tail == m_head.load(std::memory_order_acquire))
+      return false;
+    value = m_data[tail & (N - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  std::size_t size() const {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+  }
+  bool empty() const {
+    return 0 == size();
+  }
+private:
+  std::array<T, N> m_data;
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+};
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include <OgreException.h>
+
+#include "startup_profile.h"
+
+namespace {
+
+  double milliseconds(const startup_profile::clock_t::duration& value) {
+    return std::chrono::duration<double, std::milli>(value).count();
+  }
+
+  void write_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for(const char item : value) {
+      if('"' == item || '\\' == item)
+        out << '\\';
+      out << item;
+    }
+    out << '"';
+  }
+
+  std::string trim(const std::string& value) {
+    const std::string::size_type first = value.find_first_not_of(" \t\r");
+    if(std::string::npos == first)
+      return std::string();
+    return value.substr(first, value.find_last_not_of(" \t\r") - first + 1);
+  }
+
+} /* namespace */
+
+startup_profile::scope::scope(startup_profile& profile, const char* kind, const std::string& name)
+    : m_profile(profile)
+    , m_kind(kind)
+    , m_name(name)
+    , m_start(clock_t::now()) {
+}
+
+startup_profile::scope::~scope() {
+  m_profile.add(m_kind, m_name, m_start, clock_t::now());
+}
+
+startup_profile::startup_profile()
+    : m_start(clock_t::now()) {
+}
+
+void startup_profile::add(const std::string& kind, const std::string& name, const clock_t::time_point& start,
+    const clock_t::time_point& end) {
+  if(!m_finished)
+    m_entries.push_back(entry{kind, name, start - m_start, end - start});
+}
+
+void startup_profile::finish() {
+  if(m_finished)
+    return;
+  m_total = clock_t::now() - m_start;
+  m_finished = true;
+}
+
+bool startup_profile::finished() const {
+  return m_finished;
+}
+
+startup_profile::clock_t::time_point startup_profile::start() const {
+  return m_start;
+}
+
+const std::vector<startup_profile::entry>& startup_profile::entries() const {
+  return m_entries;
+}
+
+void startup_profile::write_json(const std::string& file_name) const {
+  std::ofstream out(file_name.c_str(), std::ios::out | std::ios::trunc);
+  if(!out)
+    throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+      "Failed to open startup report: " + file_name, __FILE__);
+  char number[32];
+  std::snprintf(number, sizeof(number), "%.3f", milliseconds(m_total));
+  out << "{\"total_ms\":" << number << ",\"entries\":[";
+  const char* separator = "\n";
+  for(const entry& value : m_entries) {
+    out << separator << "{\"kind\":";
+    write_string(out, value.m_kind);
+    out << ",\"name\":";
+    write_string(out, value.m_name);
+    std::snprintf(number, sizeof(number), "%.3f", milliseconds(value.m_start));
+    out << ",\"start_ms\":" << number;
+    std::snprintf(number, sizeof(number), "%.3f", milliseconds(value.m_duration));
+    out << ",\"duration_ms\":" << number << '}';
+    separator = ",\n";
+  }
+  out << "\n]}\n";
+}
+
+// An entry recorded more than once (a plugin loaded twice, a group initialised
+// again) is checked against its sum.
+std::vector<std::string> startup_profile::check(const std::string& budget_file) const {
+  std::ifstream in(budget_file.c_str());
+  if(!in)
+    throw Ogre::Exception(Ogre::Exception::ERR_FILE_NOT_FOUND,
+      "Failed to open startup budget: " + budget_file, __FILE__);
+  std::vector<std::string> res;
+  std::string line;
+  while(std::getline(in, line)) {
+    line = trim(line);
+    const std::string::size_type equal = line.find('=');
+    if(line.empty() || '#' == line[0])
+      continue;
+    if(std::string::npos == equal)
+      throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+        "Startup budget line is not <name>=<ms>: " + line, __FILE__);
+    const std::string name = trim(line.substr(0, equal));
+    const double budget = std::atof(line.substr(equal + 1).c_str());
+    double spent = 0.0;
+    bool found = "total" == name;
+    if(found)
+      spent = milliseconds(m_total);
+    for(const entry& value : m_entries)
+      if(name == value.m_kind + "/" + value.m_name) {
+        spent += milliseconds(value.m_duration);
+        found = true;
+      }
+    char message[256];
+    if(!found)
+      std::snprintf(message, sizeof(message), "%s: not recorded", name.c_str());
+    else if(spent > budget)
+      std::snprintf(message, sizeof(message), "%s: %.1f ms over budget of %.1f ms", name.c_str(), spent, budget);
+    else
+      continue;
+    res.push_back(message);
+  }
+  return res;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Wall clock of every startup step from Application construction to the end of
+// the first frame. Entries have a kind (phase, plugin, resource_group) and a
+// name; write_json() dumps them for tooling and check() compares them with a
+// budget file of `<kind>/<name>=<ms>` lines, `total=<ms>` bounds the whole run.
+class startup_profile {
+public:
+  using clock_t = std::chrono::steady_clock;
+  class entry {
+  public:
+    std::string m_kind;
+    std::string m_name;
+    clock_t::duration m_start;
+    clock_t::duration m_duration;
+  };
+  class scope {
+  public:
+    scope(startup_profile& profile, const char* kind, const std::string& name);
+    ~scope();
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+  private:
+    startup_profile& m_profile;
+    const char* m_kind;
+    const std::string m_name;
+    const clock_t::time_point m_start;
+  };
+public:
+  startup_profile();
+  void add(const std::string& kind, const std::string& name, const clock_t::time_point& start,
+    const clock_t::time_point& end);
+  void finish();
+  bool finished() const;
+  clock_t::time_point start() const;
+  const std::vector<entry>& entries() const;
+  void write_json(const std::string& file_name) const;
+  std::vector<std::string> check(const std::string& budget_file) const;
+private:
+  const clock_t::time_point m_start;
+  clock_t::duration m_total = clock_t::duration::zero();
+  bool m_finished = false;
+  std::vector<entry> m_entries;
+};
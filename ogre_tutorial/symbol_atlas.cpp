@@ -0,0 +1,187 @@
+#include <algorithm>
+
+#include <OgreException.h>
+#include <OgreLogManager.h>
+#include <OgreMaterialManager.h>
+#include <OgreTechnique.h>
+#include <OgrePass.h>
+#include <OgreTextureUnitState.h>
+#include <OgreTextureManager.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgrePixelFormat.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreStringConverter.h>
+
+#include "trace.h"
+#include "atlas_packer.h"
+#include "symbol_atlas.h"
+
+namespace {
+
+  std::size_t mip_count(const std::size_t padding) {
+    std::size_t res = 0;
+    while((std::size_t(2) << res) <= padding)
+      ++res;
+    return res;
+  }
+
+  // the mean of every 2 x 2 block, channel by channel
+  std::vector<std::uint32_t> half(const std::vector<std::uint32_t>& pixels, const std::size_t width,
+      const std::size_t height) {
+    std::vector<std::uint32_t> res(width / 2 * (height / 2));
+    for(std::size_t y = 0; y < height / 2; ++y)
+      for(std::size_t x = 0; x < width / 2; ++x) {
+        const std::uint32_t* top = &pixels[y * 2 * width + x * 2];
+        const std::uint32_t* bottom = top + width;
+        std::uint32_t value = 0;
+        for(unsigned int shift = 0; shift < 32; shift += 8) {
+          const std::uint32_t sum = ((top[0] >> shift) & 0xff) + ((top[1] >> shift) & 0xff) +
+            ((bottom[0] >> shift) & 0xff) + ((bottom[1] >> shift) & 0xff);
+          value |= ((sum + 2) / 4) << shift;
+        }
+        res[y * (width / 2) + x] = value;
+      }
+    return res;
+  }
+
+} /* namespace */
+
+symbol_atlas::symbol_atlas(const Ogre::String& name, const std::size_t page_size, const std::size_t padding)
+    : m_name(name)
+    , m_page_size(page_size)
+    , m_padding(padding) {
+  if(0 == page_size || 0 != (page_size & (page_size - 1)) || page_size < (std::size_t(1) << mip_count(padding)))
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Symbol atlas " + name + " needs a power of two page size", __FILE__);
+}
+
+symbol_atlas::~symbol_atlas() {
+  for(const Ogre::String& item : m_materials)
+    Ogre::MaterialManager::getSingleton().remove(item);
+  for(const Ogre::String& item : m_pages)
+    Ogre::TextureManager::getSingleton().remove(item);
+}
+
+std::size_t symbol_atlas::add(const Ogre::String& name, const Ogre::Image& image) {
+  return add(name, image, Ogre::Box(0, 0, image.getWidth(), image.getHeight()));
+}
+
+std::size_t symbol_atlas::add(const Ogre::String& name, const Ogre::Image& image, const Ogre::Box& part) {
+  if(!m_pages.empty())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALID_STATE, "Symbol atlas " + m_name + " is built", __FILE__);
+  if(0 == part.getWidth() || 0 == part.getHeight())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS, "Symbol " + name + " is empty", __FILE__);
+  source res{part.getWidth(), part.getHeight()};
+  res.m_pixels.resize(res.m_width * res.m_height);
+  const Ogre::PixelBox target(res.m_width, res.m_height, 1, Ogre::PF_A8R8G8B8, res.m_pixels.data());
+  Ogre::PixelUtil::bulkPixelConversion(image.getPixelBox().getSubVolume(part), target);
+  m_sources.push_back(std::move(res));
+  m_names.push_back(name);
+  return m_names.size() - 1;
+}
+
+void symbol_atlas::build() {
+  TRACE_ZONE("symbol_atlas::build");
+  if(!m_pages.empty())
+    return;
+  // packed in units of the grid, padded sizes rounded up to it
+  const std::size_t mips = mip_count(m_padding);
+  const std::size_t grid = std::size_t(1) << mips;
+  std::vector<atlas_rect> rects;
+  for(const source& item : m_sources)
+    rects.push_back(atlas_rect{(item.m_width + m_padding * 2 + grid - 1) / grid,
+      (item.m_height + m_padding * 2 + grid - 1) / grid});
+  const std::size_t page_count = pack_atlas(rects, m_page_size / grid, m_page_size / grid);
+  if(0 == page_count && !rects.empty())
+    throw Ogre::Exception(Ogre::Exception::ERR_INVALIDPARAMS,
+      "Symbol atlas " + m_name + " has a symbol larger than a page", __FILE__);
+
+  std::vector<std::vector<std::vector<std::uint32_t>>> pages(page_count);
+  for(std::vector<std::vector<std::uint32_t>>& levels : pages)
+    for(std::size_t level = 0; level <= mips; ++level)
+      levels.emplace_back((m_page_size >> level) * (m_page_size >> level), 0);
+  const Ogre::Real texel = Ogre::Real(1) / m_page_size;
+  std::size_t covered = 0;
+  for(std::size_t i = 0; i < m_sources.size(); ++i) {
+    const source& item = m_sources[i];
+    const atlas_rect& rect = rects[i];
+    // the padding repeats the nearest edge pixel
+    std::size_t width = rect.m_width * grid;
+    std::size_t height = rect.m_height * grid;
+    std::vector<std::uint32_t> pixels(width * height);
+    for(std::size_t y = 0; y < height; ++y)
+      for(std::size_t x = 0; x < width; ++x) {
+        const std::size_t column = std::min(std::max(x, m_padding) - m_padding, item.m_width - 1);
+        const std::size_t row = std::min(std::max(y, m_padding) - m_padding, item.m_height - 1);
+        pixels[y * width + x] = item.m_pixels[row * item.m_width + column];
+      }
+    for(std::size_t level = 0; level <= mips; ++level) {
+      const std::size_t page_width = m_page_size >> level;
+      std::uint32_t* target = &pages[rect.m_page][level][((rect.m_y * grid) >> level) * page_width +
+        ((rect.m_x * grid) >> level)];
+      for(std::size_t y = 0; y < height; ++y)
+        std::copy(&pixels[y * width], &pixels[y * width] + width, target + y * page_width);
+      if(level < mips) {
+        pixels = half(pixels, width, height);
+        width /= 2;
+        height /= 2;
+      }
+    }
+    const Ogre::Real left = (rect.m_x * grid + m_padding) * texel;
+    const Ogre::Real top = (rect.m_y * grid + m_padding) * texel;
+    m_symbols.push_back(symbol{rect.m_page,
+      Ogre::FloatRect(left, top, left + item.m_width * texel, top + item.m_height * texel)});
+    covered += item.m_width * item.m_height;
+  }
+
+  for(std::size_t page = 0; page < page_count; ++page) {
+    m_pages.push_back(m_name + "/" + std::to_string(page));
+    Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().createManual(m_pages.back(),
+      Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, Ogre::TEX_TYPE_2D, m_page_size, m_page_size, mips,
+      Ogre::PF_A8R8G8B8, Ogre::TU_STATIC_WRITE_ONLY);
+    for(std::size_t level = 0; level <= mips; ++level)
+      texture->getBuffer(0, level)->blitFromMemory(Ogre::PixelBox(m_page_size >> level, m_page_size >> level, 1,
+        Ogre::PF_A8R8G8B8, pages[page][level].data()));
+  }
+  // the sources are in the textures now
+  m_sources.clear();
+  m_sources.shrink_to_fit();
+  Ogre::LogManager::getSingleton().logMessage("Symbol atlas " + m_name + ": " + std::to_string(m_symbols.size()) +
+    " symbols on " + std::to_string(page_count) + " pages, " +
+    Ogre::StringConverter::toString(page_count ? 100.0f * covered / (page_count * m_page_size * m_page_size) : 0.0f) +
+    "% covered");
+}
+
+std::size_t symbol_atlas::find(const Ogre::String& name) const {
+  const auto res = std::find(m_names.begin(), m_names.end(), name);
+  if(m_names.end() != res)
+    return res - m_names.begin();
+  throw Ogre::Exception(Ogre::Exception::ERR_ITEM_NOT_FOUND, "Symbol atlas " + m_name + " has no " + name, __FILE__);
+}
+
+const symbol_atlas::symbol& symbol_atlas::at(const std::size_t index) const {
+  return m_symbols.at(index);
+}
+
+std::size_t symbol_atlas::size() const {
+  return m_symbols.size();
+}
+
+std::size_t symbol_atlas::page_count() const {
+  return m_pages.size();
+}
+
+const Ogre::String& symbol_atlas::page(const std::size_t index) const {
+  return m_pages.at(index);
+}
+
+Ogre::String symbol_atlas::material(const std::size_t page, const Ogre::String& base) {
+  const Ogre::String res = base + "/" + m_pages.at(page);
+  Ogre::MaterialManager& manager = Ogre::MaterialManager::getSingleton();
+  if(manager.resourceExists(res))
+    return res;
+  Ogre::MaterialPtr material = manager.getByName(base)->clone(res);
+  material->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureName(m_pages[page]);
+  m_materials.push_back(res);
+  return res;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreCommon.h>
+#include <OgreImage.h>
+
+// Packs symbol images into square atlas pages at load time, so reels of any
+// design share a few textures instead of a pre drawn strip each. Every symbol
+// is surrounded by padding filled with its own edge pixels and placed on a
+// grid of 2^n texels, n the number of mip levels below the base, so it covers
+// whole texels on every level. The levels are box filtered per symbol, not
+// per page: bilinear filtering never reaches a neighbour on any level as
+// long as the chain stops where the padding runs out, at log2(padding).
+class symbol_atlas {
+public:
+  class symbol {
+  public:
+    std::size_t m_page;
+    Ogre::FloatRect m_uv;  // without the padding
+  };
+public:
+  symbol_atlas(const Ogre::String& name, const std::size_t page_size = 1024, const std::size_t padding = 4);
+  ~symbol_atlas();
+  symbol_atlas(const symbol_atlas&) = delete;
+  symbol_atlas& operator=(const symbol_atlas&) = delete;
+  // the image or a part of it, copied as 32 bit ARGB; returns the index
+  std::size_t add(const Ogre::String& name, const Ogre::Image& image);
+  std::size_t add(const Ogre::String& name, const Ogre::Image& image, const Ogre::Box& part);
+  // packs what was added and creates the page textures, once
+  void build();
+  std::size_t find(const Ogre::String& name) const;
+  // the rest once it is built
+  const symbol& at(const std::size_t index) const;
+  std::size_t size() const;
+  std::size_t page_count() const;
+  const Ogre::String& page(const std::size_t index) const;
+  // a copy of base with the page as its first texture, created once
+  Ogre::String material(const std::size_t page, const Ogre::String& base);
+private:
+  class source {
+  public:
+    std::size_t m_width;
+    std::size_t m_height;
+    std::vector<std::uint32_t> m_pixels;
+  };
+private:
+  const Ogre::String m_name;
+  const std::size_t m_page_size;
+  const std::size_t m_padding;
+  std::vector<Ogre::String> m_names;
+  std::vector<source> m_sources;  // until build
+  std::vector<symbol> m_symbols;
+  std::vector<Ogre::String> m_pages;
+  std::vector<Ogre::String> m_materials;
+};
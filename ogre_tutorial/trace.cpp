@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <OgreException.h>
+
+#include "trace.h"
+
+namespace {
+
+  class event {
+  public:
+    const char* m_name;
+    tracer::clock_t::time_point m_time;
+    char m_phase;
+  };
+
+  class thread_buffer {
+  public:
+    thread_buffer(const std::size_t capacity, const unsigned int id)
+      : m_events(capacity), m_id(id) {
+    }
+  public:
+    std::mutex m_mutex;
+    std::vector<event> m_events;
+    std::size_t m_next = 0;
+    bool m_wrapped = false;
+    const unsigned int m_id;
+    std::string m_name;
+  };
+
+  using thread_buffer_ptr = std::shared_ptr<thread_buffer>;
+
+  std::mutex registry_mutex;
+  std::vector<thread_buffer_ptr> registry;
+  std::size_t buffer_capacity = 0;
+  tracer::clock_t::time_point epoch;
+
+  thread_local thread_buffer_ptr local;
+
+  thread_buffer& local_buffer() {
+    if(!local) {
+      std::lock_guard<std::mutex> lock(registry_mutex);
+      local = std::make_shared<thread_buffer>(buffer_capacity, static_cast<unsigned int>(registry.size() + 1));
+      registry.push_back(local);
+    }
+    return *local;
+  }
+
+  void write_name(std::ostream& out, const char* value) {
+    out << '"';
+    for(; 0 != *value; ++value) {
+      if('"' == *value || '\\' == *value)
+        out << '\\';
+      out << *value;
+    }
+    out << '"';
+  }
+
+} /* namespace */
+
+std::atomic<bool> tracer::m_enabled(false);
+
+tracer::zone::zone(const char* name)
+    : m_name(tracer::enabled() ? name : 0) {
+  if(0 != m_name)
+    tracer::record(m_name, 'B');
+}
+
+tracer::zone::~zone() {
+  if(0 != m_name)
+    tracer::record(m_name, 'E');
+}
+
+void tracer::enable(const std::size_t events_per_thread) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  if(m_enabled.load())
+    return;
+  buffer_capacity = events_per_thread;
+  epoch = clock_t::now();
+  m_enabled.store(true, std::memory_order_release);
+}
+
+bool tracer::enabled() {
+  return m_enabled.load(std::memory_order_relaxed);
+}
+
+void tracer::begin(const char* name) {
+  if(enabled())
+    record(name, 'B');
+}
+
+void tracer::end(const char* name) {
+  if(enabled())
+    record(name, 'E');
+}
+
+void tracer::set_thread_name(const std::string& value) {
+  if(!enabled())
+    return;
+  thread_buffer& buffer = local_buffer();
+  std::lock_guard<std::mutex> lock(buffer.m_mutex);
+  buffer.m_name = value;
+}
+
+void tracer::write(const std::string& file_name, const clock_t::duration& window) {
+  const clock_t::time_point now = clock_t::now();
+  const clock_t::time_point from = clock_t::duration::max() == window || now - epoch < window ?
+    epoch : now - window;
+  std::vector<thread_buffer_ptr> buffers;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffers = registry;
+  }
+  std::ofstream out(file_name.c_str(), std::ios::out | std::ios::trunc);
+  if(!out)
+    throw Ogre::Exception(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+      "Failed to open trace file: " + file_name, __FILE__);
+  out << "{\"traceEvents\":[";
+  const char* separator = "\n";
+  std::vector<event> events;
+  for(const thread_buffer_ptr& buffer : buffers) {
+    std::string name;
+    events.clear();
+    {
+      std::lock_guard<std::mutex> lock(buffer->m_mutex);
+      name = buffer->m_name;
+      const std::size_t count = buffer->m_wrapped ? buffer->m_events.size() : buffer->m_next;
+      const std::size_t first = buffer->m_wrapped ? buffer->m_next : 0;
+      for(std::size_t i = 0; i < count; ++i) {
+        const event& value = buffer->m_events[(first + i) % buffer->m_events.size()];
+        if(value.m_time >= from)
+          events.push_back(value);
+      }
+    }
+    if(!name.empty()) {
+      out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_id
+        << ",\"args\":{\"name\":";
+      write_name(out, name.c_str());
+      out << "}}";
+      separator = ",\n";
+    }
+    for(const event& value : events) {
+      char ts[32];
+      std::snprintf(ts, sizeof(ts), "%.3f",
+        std::chrono::duration<double, std::micro>(value.m_time - epoch).count());
+      out << separator << "{\"name\":";
+      write_name(out, value.m_name);
+      out << ",\"ph\":\"" << value.m_phase << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << buffer->m_id << '}';
+      separator = ",\n";
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void tracer::record(const char* name, const char phase) {
+  thread_buffer& buffer = local_buffer();
+  const clock_t::time_point now = clock_t::now();
+  std::lock_guard<std::mutex> lock(buffer.m_mutex);
+  event& value = buffer.m_events[buffer.m_next];
+  value.m_name = name;
+  value.m_time = now;
+  value.m_phase = phase;
+  if(++buffer.m_next == buffer.m_events.size()) {
+    buffer.m_next = 0;
+    buffer.m_wrapped = true;
+  }
+}
+
+hitch_detector::hitch_detector(const tracer::clock_t::duration& budget,
+      const tracer::clock_t::duration& window, const std::string& prefix)
+    : m_budget(budget)
+    , m_window(window)
+    , m_prefix(prefix)
+    , m_writer(&hitch_detector::write_loop, this) {
+}
+
+// a queued dump is still written
+hitch_detector::~hitch_detector() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_wake.notify_one();
+  m_writer.join();
+}
+
+bool hitch_detector::frame(const tracer::clock_t::duration& value) {
+  if(value <= m_budget)
+    return false;
+  const tracer::clock_t::time_point now = tracer::clock_t::now();
+  if(0 != m_count && now - m_last_flush < m_window)
+    return false;
+  m_last_flush = now;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.push_back(m_prefix + "-" + std::to_string(++m_count) + ".json");
+  }
+  m_wake.notify_one();
+  return true;
+}
+
+std::vector<std::string> hitch_detector::errors() {
+  std::vector<std::string> res;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  res.swap(m_errors);
+  return res;
+}
+
+void hitch_detector::write_loop() {
+  tracer::set_thread_name("hitch_writer");
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(true) {
+    m_wake.wait(lock, [&](){ return !m_running || !m_files.empty(); });
+    if(m_files.empty())
+      break;
+    const std::string file_name = m_files.front();
+    m_files.pop_front();
+    lock.unlock();
+    bool failed = false;
+    std::string error;
+    try {
+      tracer::write(file_name, m_window);
+    }
+    catch(const Ogre::Exception& e) {
+      failed = true;
+      error = e.getDescription();
+    }
+    lock.lock();
+    if(failed)
+      m_errors.push_back(error);
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scoped zone tracing into per-thread ring buffers, written out as Chrome
+// trace-event JSON (chrome://tracing, ui.perfetto.dev). Zone names must be
+// string literals, recording is a no-op until tracer::enable() is called.
+class tracer {
+public:
+  using clock_t = std::chrono::steady_clock;
+  class zone {
+  public:
+    explicit zone(const char* name);
+    ~zone();
+    zone(const zone&) = delete;
+    zone& operator=(const zone&) = delete;
+  private:
+    const char* m_name;
+  };
+public:
+  static void enable(const std::size_t events_per_thread = 1 << 16);
+  static bool enabled();
+  static void begin(const char* name);
+  static void end(const char* name);
+  static void set_thread_name(const std::string& value);
+  static void write(const std::string& file_name, const clock_t::duration& window = clock_t::duration::max());
+private:
+  static void record(const char* name, const char phase);
+private:
+  static std::atomic<bool> m_enabled;
+};
+
+// Writes the last `window` of trace to `<prefix>-<n>.json` when a frame exceeds
+// the budget, at most once per window. The file is written by a thread of its
+// own, so the dump does not cause the next hitch; failed writes are kept for
+// errors() instead of thrown.
+class hitch_detector {
+public:
+  hitch_detector(const tracer::clock_t::duration& budget, const tracer::clock_t::duration& window,
+    const std::string& prefix);
+  ~hitch_detector();
+  hitch_detector(const hitch_detector&) = delete;
+  hitch_detector& operator=(const hitch_detector&) = delete;
+  // true if a dump was queued
+  bool frame(const tracer::clock_t::duration& value);
+  // the failures since the last call
+  std::vector<std::string> errors();
+private:
+  void write_loop();
+private:
+  const tracer::clock_t::duration m_budget;
+  const tracer::clock_t::duration m_window;
+  const std::string m_prefix;
+  tracer::clock_t::time_point m_last_flush;
+  unsigned int m_count = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<std::string> m_files;
+  std::vector<std::string> m_errors;
+  bool m_running = true;
+  std::thread m_writer;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) tracer::zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
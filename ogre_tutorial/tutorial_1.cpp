@@ -11,11 +11,11 @@
 
 class tutorial1 : public Application {
 public:
-  tutorial1();
+  tutorial1(const options& value);
   void createScene() override;
 };
 
-tutorial1::tutorial1() : Application("plugins.cfg","resources-1.9.cfg"){
+tutorial1::tutorial1(const options& value) : Application("plugins.cfg", "resources-1.9.cfg", value) {
 }
 
 void tutorial1::createScene()
@@ -46,7 +46,7 @@ void tutorial1::createScene()
   camNode->setPosition(0, 50, 300);
 
   // and tell it to render into the main window
-  get_render_window()->addViewport(cam);
+  get_render_target()->addViewport(cam);
 
   // finally something to render
   Ogre::Entity* ent = scnMgr->createEntity("ogrehead.mesh");
@@ -58,7 +58,7 @@ void tutorial1::createScene()
 
 int main(int ac, char* av[]) {
   try {
-    tutorial1 app;
+    tutorial1 app(Application::options(ac, av));
     app.startApplication();
     return 0;
   }
@@ -10,269 +10,15 @@
 #include <OgreFrameListener.h>
 
 #include "application.h"
-
-namespace {
-  template<typename T, std::size_t N>
-  std::size_t array_size(T(&)[N]) {
-    return N;
-  }
-} /* namespace */
-
-namespace {
-
-  void slot_machine() {
-    const static std::size_t face_count = 36;
-    const static double step = 2 * M_PI / face_count;
-    const static double wheel_xpos = 0;
-    const static double wheel_width = 20.0;
-    const static double radius = 50;
-    //std::ofstream o("test.txt");
-
-    Ogre::Vector3 vertices[face_count][2][2];
-    unsigned short faces[face_count][2][3];
-    Ogre::RGBA colours[face_count][2];
-    Ogre::RenderSystem* rs = Ogre::Root::getSingleton().getRenderSystem();
-
-    double rad = -M_PI;
-    for(size_t i = 0; i < face_count; ++i) {
-      const double x = std::cos(rad);
-      const double y = std::sin(rad);
-      rad += step;
-      vertices[i][0][0] = Ogre::Vector3(wheel_xpos, y * radius, x * radius);
-      vertices[i][1][0] = Ogre::Vector3(wheel_xpos + wheel_width, y * radius, x * radius);
-      vertices[i][0][1] = Ogre::Vector3(0,0,1);
-      vertices[i][1][1] = Ogre::Vector3(0,0,1);
-      const int dd = i % 7; 
-      rs->convertColourValue(Ogre::ColourValue(dd & 1, dd & 2, dd & 4), &colours[i][0]);
-      rs->convertColourValue(Ogre::ColourValue(dd & 4, dd & 2, dd & 1), &colours[i][1]);
-
-      //o << x << ';' << y << std::endl;
-
-      const unsigned short ii = i * 2;
-      faces[i][0][0] = ii;
-      faces[i][0][1] = (ii + 3) % (face_count * 2);
-      faces[i][0][2] = ii + 1;
-      faces[i][1][0] = ii;
-      faces[i][1][1] = (ii + 2) % (face_count * 2);
-      faces[i][1][2] = (ii + 3) % (face_count * 2);
-//      o << faces[i][0][0] << " ";
-//      o << faces[i][0][1] << " ";
-//      o << faces[i][0][2] << std::endl;
-//      o << faces[i][1][0] << " ";
-//      o << faces[i][1][1] << " ";
-//      o << faces[i][1][2] << std::endl;
-    }
-
-    Ogre::VertexData* wd = new Ogre::VertexData();
-    wd->vertexCount = face_count * 2;
-
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = wd->vertexDeclaration;
-    size_t offset = 0;
-    // 1st buffer
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      offset, wd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-    wd->vertexBufferBinding->setBinding(0, vbuf);
-
-    // 2ed buffer
-    offset = 0;
-    decl->addElement(1, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      offset, wd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), colours, true);
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    wd->vertexBufferBinding->setBinding(1, vbuf);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-          createIndexBuffer(Ogre::HardwareIndexBuffer::IT_16BIT, face_count * 2 * 3, 
-          Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual("SpotWheel", "General");
-    msh->sharedVertexData = wd;
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = face_count * 2 * 3;
-    sub->indexData->indexStart = 0;
-
-    /// Set bounding information (for culling)
-    msh->_setBounds(Ogre::AxisAlignedBox(0, -radius, -radius, wheel_width, radius, radius));
-    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(radius * radius + wheel_width / 2));
-
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
-
-    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().create(
-      "Test/ColourTest1", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-      material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
-
-  #if 0
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual("SpotWheel", "General");
-
-
-    /// Set vertex buffer binding so buffer 0 is bound to our vertex buffer
-    Ogre::VertexBufferBinding* bind = msh->sharedVertexData->vertexBufferBinding; 
-    bind->setBinding(0, vbuf);
-  #endif
-  }
-
-  void createColourCube()
-  {
-    /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual("ColourCube", "General");
-
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
-
-    const float sqrt13 = 0.577350269f; /* sqrt(1/3) */
-
-    /// Define the vertices (8 vertices, each have 3 floats for position and 3 for normal)
-    const size_t nVertices = 8;
-    const size_t vbufCount = 3*2*nVertices;
-    float vertices[vbufCount] = {
-            -100.0,100.0,-100.0,        //0 position A
-            -sqrt13,sqrt13,-sqrt13,     //0 normal
-            100.0,100.0,-100.0,         //1 position B
-            sqrt13,sqrt13,-sqrt13,      //1 normal
-            100.0,-100.0,-100.0,        //2 position C               A-----B
-            sqrt13,-sqrt13,-sqrt13,     //2 normal                  /|    /|
-            -100.0,-100.0,-100.0,       //3 position D             / |   / |
-            -sqrt13,-sqrt13,-sqrt13,    //3 normal                /  D--/--C
-            -100.0,100.0,100.0,         //4 position E           /  /  /  / 
-            -sqrt13,sqrt13,sqrt13,      //4 normal              E--/--F  / 
-            100.0,100.0,100.0,          //5 position F          | /   | /
-            sqrt13,sqrt13,sqrt13,       //5 normal              |/    |/
-            100.0,-100.0,100.0,         //6 position G          H-----G
-            sqrt13,-sqrt13,sqrt13,      //6 normal
-            -100.0,-100.0,100.0,        //H position 7
-            -sqrt13,-sqrt13,sqrt13,     //7 normal
-    };
-
-    Ogre::RenderSystem* rs = Ogre::Root::getSingleton().getRenderSystem();
-    Ogre::RGBA colours[nVertices];
-    Ogre::RGBA *pColour = colours;
-    // Use render system to convert colour value since colour packing varies
-    rs->convertColourValue(Ogre::ColourValue(1.0,0.0,0.0), pColour++); //0 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,1.0,0.0), pColour++); //1 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,1.0,0.0), pColour++); //2 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,0.0,0.0), pColour++); //3 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,0.0,1.0), pColour++); //4 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,1.0,1.0), pColour++); //5 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,1.0,1.0), pColour++); //6 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,0.0,1.0), pColour++); //7 colour
-
-    /// Define 12 triangles (two triangles per cube face)
-    /// The values in this table refer to vertices in the above table
-    const size_t ibufCount = 36;
-    unsigned short faces[ibufCount] = {
-            0,2,3,
-            0,1,2,
-            1,6,2,
-            1,5,6,
-            4,6,5,
-            4,7,6,
-            0,7,4,
-            0,3,7,
-            0,5,1,
-            0,4,5,
-            2,7,3,
-            2,6,7
-    };
-
-    /// Create vertex data structure for 8 vertices shared between submeshes
-    msh->sharedVertexData = new Ogre::VertexData();
-    msh->sharedVertexData->vertexCount = nVertices;
-
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = msh->sharedVertexData->vertexDeclaration;
-    size_t offset = 0;
-    // 1st buffer
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf = 
-        Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-
-    /// Set vertex buffer binding so buffer 0 is bound to our vertex buffer
-    Ogre::VertexBufferBinding* bind = msh->sharedVertexData->vertexBufferBinding; 
-    bind->setBinding(0, vbuf);
-
-    // 2nd buffer
-    offset = 0;
-    decl->addElement(1, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), colours, true);
-
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    bind->setBinding(1, vbuf);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-        createIndexBuffer(
-        Ogre::HardwareIndexBuffer::IT_16BIT, 
-        ibufCount, 
-        Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = ibufCount;
-    sub->indexData->indexStart = 0;
-
-    /// Set bounding information (for culling)
-    msh->_setBounds(Ogre::AxisAlignedBox(-100,-100,-100,100,100,100));
-    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(3*100*100));
-
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
-
-    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().create(
-      "Test/ColourTest", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-      material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
-  }
-
-} /* namespace */
+#include "procedural_mesh.h"
 
 class tutorial3 : public Application {
 public:
-  tutorial3();
+  tutorial3(const options& value);
   void createScene() override;
 };
 
-tutorial3::tutorial3() : Application("plugins.cfg", "resources-1.9.cfg") {
+tutorial3::tutorial3(const options& value) : Application("plugins.cfg", "resources-1.9.cfg", value) {
 }
 
 void tutorial3::createScene()
@@ -285,7 +31,7 @@ void tutorial3::createScene()
   camera->lookAt(Ogre::Vector3(0, 0, 0)/*, Ogre::Node::TransformSpace::TS_WORLD*/);
   camera->setNearClipDistance( 5 );
 
-  Ogre::Viewport* viewPort = get_render_window()->addViewport( camera );
+  Ogre::Viewport* viewPort = get_render_target()->addViewport( camera );
   viewPort->setBackgroundColour( Ogre::ColourValue( 0, 0, 0 ) );
   camera->setAspectRatio( Ogre::Real( viewPort->getActualWidth() ) / Ogre::Real( viewPort->getActualHeight() ) );
 
@@ -294,8 +40,10 @@ void tutorial3::createScene()
   light->setPosition(0.0f, 0.0f, 120.0f);
 
 
-  createColourCube();
-  slot_machine();
+  create_colour_material("Test/ColourTest");
+  cached_mesh(mesh_key("SpotWheel", "colour_wheel", procedural_mesh_version).add("faces", 36).add("radius", 50)
+    .add("width", 20).add("render_system", Ogre::Root::getSingleton().getRenderSystem()->getName()),
+    [&](){ return create_colour_wheel("SpotWheel", 36, 50, 20); });
   Ogre::Entity* thisEntity = sceneManager->createEntity("cc", "SpotWheel");
   thisEntity->setMaterialName("Test/ColourTest");
   Ogre::SceneNode* thisSceneNode = sceneManager->getRootSceneNode()->createChildSceneNode();
@@ -304,7 +52,7 @@ void tutorial3::createScene()
   thisSceneNode->pitch(Ogre::Radian(1.0));
   thisSceneNode->attachObject(thisEntity);
 #if 0
-  createColourCube();
+  create_colour_cube("ColourCube", 100);
   Ogre::Entity* thisEntity = sceneManager->createEntity("cc", "ColourCube");
   thisEntity->setMaterialName("Test/ColourTest");
   Ogre::SceneNode* thisSceneNode = sceneManager->getRootSceneNode()->createChildSceneNode();
@@ -317,7 +65,7 @@ void tutorial3::createScene()
 
 int main(int ac, char* av[]) {
   try {
-    tutorial3 app;
+    tutorial3 app(Application::options(ac, av));
     app.startApplication();
     return 0;
   }
@@ -4,7 +4,6 @@
 #include <iostream>
 #include <exception>
 #include <type_traits>
-#include <chrono>
 
 #include <Ogre.h>
 #include <OgreRoot.h>
@@ -16,285 +15,13 @@
 #include <OISKeyboard.h>
 
 #include "application.h"
-
-namespace {
-  template<typename T, std::size_t N>
-  std::size_t array_size(T(&)[N]) {
-    return N;
-  }
-} /* namespace */
-
-namespace {
-
-  void sample_material() {
-    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().create(
-      "Test/ColourTest", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-      material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
-  }
-
-  void create_mash(const Ogre::String& name, const Ogre::String& group, Ogre::VertexData* vd, std::size_t count,
-      Ogre::HardwareIndexBufferSharedPtr ibuf, const Ogre::AxisAlignedBox& box, const double radius) {
-      /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual(name, group);
-    msh->sharedVertexData = vd;
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = count;
-    sub->indexData->indexStart = 0;
-
-    /// Set bounding information (for culling)
-    msh->_setBounds(box);
-    msh->_setBoundingSphereRadius(radius);
-
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
-  }
-
-  template<typename T, std::size_t N>
-  void slot_machine_faces(T(&faces)[N][2][3], const std::size_t index) {
-    static const std::size_t dev = N * 2;
-    const T i = index * 2;
-    faces[index][0][0] = i;
-    faces[index][0][1] = (i + 3) % dev;
-    faces[index][0][2] = i + 1;
-    faces[index][1][0] = i;
-    faces[index][1][1] = (i + 2) % dev;
-    faces[index][1][2] = (i + 3) % dev;
-  }
-
-  inline Ogre::Vector3 create_normal(const Ogre::Vector3& a, const Ogre::Vector3& b,
-      const Ogre::Vector3& c) {
-    Ogre::Vector3 res = (c - a).crossProduct(b - a);
-    res.normalise();
-    return res;
-    
-  }
-
-  template<std::size_t face_count>
-  void apply_normal(Ogre::Vector3(&vertices)[face_count][2][2], std::size_t i) {
-    if(0 != i) {
-      const std::size_t pi = i - 1;
-      vertices[pi][0][1] = create_normal(vertices[pi][0][0], vertices[i][0][0], vertices[pi][1][0]);
-      vertices[pi][1][1] = create_normal(vertices[pi][1][0], vertices[pi][0][0], vertices[i][1][0]);
-      if(1 == face_count - i) {
-        vertices[i][0][1] = create_normal(vertices[i][0][0], vertices[0][0][0], vertices[i][1][0]);
-        vertices[i][1][1] = create_normal(vertices[i][1][0], vertices[i][0][0], vertices[0][1][0]);
-      }
-    }
-  }
-
-  template<std::size_t face_count, typename face_index_t = unsigned short>
-  void slot_machine_wheel(const double radius, const double width) {
-    static_assert(std::is_integral<face_index_t>::value && (sizeof(face_index_t) == sizeof(short) ||
-      sizeof(face_index_t) == sizeof(int)), "face_index_t must by integer and 16 or 32 bit");
-
-    const Ogre::HardwareIndexBuffer::IndexType index_type = sizeof(face_index_t) == sizeof(unsigned short) ?
-      Ogre::HardwareIndexBuffer::IT_16BIT : Ogre::HardwareIndexBuffer::IT_32BIT;
-    const double step = 2 * M_PI / face_count;
-    const double xpos = 0;
-
-    Ogre::Vector3 vertices[face_count][2][2];
-    face_index_t faces[face_count][2][3];
-
-    Ogre::RGBA colours[face_count][2];
-    Ogre::RenderSystem* rs = Ogre::Root::getSingleton().getRenderSystem();
-
-    double rad = -M_PI;
-    for(std::size_t i = 0; i < face_count; ++i) {
-      const double x = std::cos(rad);
-      const double y = std::sin(rad);
-      rad += step;
-      {
-        const int dd = i % 7; 
-        rs->convertColourValue(Ogre::ColourValue(dd & 1, dd & 2, dd & 4), &colours[i][0]);
-        rs->convertColourValue(Ogre::ColourValue(dd & 4, dd & 2, dd & 1), &colours[i][1]);
-      }
-      slot_machine_faces(faces, i);
-
-      vertices[i][0][0] = Ogre::Vector3(xpos, y * radius, x * radius);
-      vertices[i][1][0] = Ogre::Vector3(xpos + width, y * radius, x * radius);
-      apply_normal(vertices, i);
-    }
-
-    Ogre::VertexData* vd = new Ogre::VertexData();
-    vd->vertexCount = face_count * 2;
-
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = vd->vertexDeclaration;
-    size_t offset = 0;
-    // 1st buffer
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      offset, vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-    vd->vertexBufferBinding->setBinding(0, vbuf);
-
-    // 2ed buffer
-    offset = 0;
-    decl->addElement(1, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      offset, vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), colours, true);
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    vd->vertexBufferBinding->setBinding(1, vbuf);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-          createIndexBuffer(index_type, face_count * 2 * 3, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    create_mash("SpotWheel", "General", vd, face_count * 2 * 3, ibuf,
-      Ogre::AxisAlignedBox(0, -radius, -radius, width, radius, radius),
-      Ogre::Math::Sqrt(radius * radius + (width/2) * (width/2)));
-
-  }
-
-  void createColourCube()
-  {
-    /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual("ColourCube", "General");
-
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
-
-    const float sqrt13 = 0.577350269f; /* sqrt(1/3) */
-
-    /// Define the vertices (8 vertices, each have 3 floats for position and 3 for normal)
-    const size_t nVertices = 8;
-    const size_t vbufCount = 3*2*nVertices;
-    float vertices[vbufCount] = {
-            -100.0,100.0,-100.0,        //0 position A
-            -sqrt13,sqrt13,-sqrt13,     //0 normal
-            100.0,100.0,-100.0,         //1 position B
-            sqrt13,sqrt13,-sqrt13,      //1 normal
-            100.0,-100.0,-100.0,        //2 position C               A-----B
-            sqrt13,-sqrt13,-sqrt13,     //2 normal                  /|    /|
-            -100.0,-100.0,-100.0,       //3 position D             / |   / |
-            -sqrt13,-sqrt13,-sqrt13,    //3 normal                /  D--/--C
-            -100.0,100.0,100.0,         //4 position E           /  /  /  / 
-            -sqrt13,sqrt13,sqrt13,      //4 normal              E--/--F  / 
-            100.0,100.0,100.0,          //5 position F          | /   | /
-            sqrt13,sqrt13,sqrt13,       //5 normal              |/    |/
-            100.0,-100.0,100.0,         //6 position G          H-----G
-            sqrt13,-sqrt13,sqrt13,      //6 normal
-            -100.0,-100.0,100.0,        //H position 7
-            -sqrt13,-sqrt13,sqrt13,     //7 normal
-    };
-
-    Ogre::RenderSystem* rs = Ogre::Root::getSingleton().getRenderSystem();
-    Ogre::RGBA colours[nVertices];
-    Ogre::RGBA *pColour = colours;
-    // Use render system to convert colour value since colour packing varies
-    rs->convertColourValue(Ogre::ColourValue(1.0,0.0,0.0), pColour++); //0 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,1.0,0.0), pColour++); //1 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,1.0,0.0), pColour++); //2 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,0.0,0.0), pColour++); //3 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,0.0,1.0), pColour++); //4 colour
-    rs->convertColourValue(Ogre::ColourValue(1.0,1.0,1.0), pColour++); //5 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,1.0,1.0), pColour++); //6 colour
-    rs->convertColourValue(Ogre::ColourValue(0.0,0.0,1.0), pColour++); //7 colour
-
-    /// Define 12 triangles (two triangles per cube face)
-    /// The values in this table refer to vertices in the above table
-    const size_t ibufCount = 36;
-    unsigned short faces[ibufCount] = {
-            0,2,3,
-            0,1,2,
-            1,6,2,
-            1,5,6,
-            4,6,5,
-            4,7,6,
-            0,7,4,
-            0,3,7,
-            0,5,1,
-            0,4,5,
-            2,7,3,
-            2,6,7
-    };
-
-    /// Create vertex data structure for 8 vertices shared between submeshes
-    msh->sharedVertexData = new Ogre::VertexData();
-    msh->sharedVertexData->vertexCount = nVertices;
-
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = msh->sharedVertexData->vertexDeclaration;
-    size_t offset = 0;
-    // 1st buffer
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf = 
-        Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-
-    /// Set vertex buffer binding so buffer 0 is bound to our vertex buffer
-    Ogre::VertexBufferBinding* bind = msh->sharedVertexData->vertexBufferBinding; 
-    bind->setBinding(0, vbuf);
-
-    // 2nd buffer
-    offset = 0;
-    decl->addElement(1, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), colours, true);
-
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    bind->setBinding(1, vbuf);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-        createIndexBuffer(
-        Ogre::HardwareIndexBuffer::IT_16BIT, 
-        ibufCount, 
-        Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = ibufCount;
-    sub->indexData->indexStart = 0;
-
-    /// Set bounding information (for culling)
-    msh->_setBounds(Ogre::AxisAlignedBox(-100,-100,-100,100,100,100));
-    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(3*100*100));
-
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
-  }
-
-} /* namespace */
+#include "procedural_mesh.h"
+#include "trace.h"
 
 class tutorial4
     : public Application {
 public:
-  tutorial4();
+  tutorial4(const options& value);
   void createScene() override;
 private:
   bool mouse_moved(const OIS::MouseEvent& value);
@@ -303,35 +30,35 @@ private:
   bool key_pressed(const OIS::KeyEvent& value);
 	bool key_released(const OIS::KeyEvent& value);
   bool frame_startted(const Ogre::FrameEvent& value);
+  bool simulate(const double step);
 private:
   Ogre::Camera* camera = 0;
   Ogre::SceneNode* sw = 0;
   Ogre::Vector3 rotate;
-  std::chrono::system_clock::time_point m_previous;
+  Ogre::Quaternion m_previous;
+  Ogre::Quaternion m_current;
   int x = 0;
   int y = 0;
   int z = 0;
 };
 
-tutorial4::tutorial4() : Application("plugins.cfg", "resources-1.9.cfg") {
+tutorial4::tutorial4(const options& value) : Application("plugins.cfg", "resources-1.9.cfg", value) {
   const std::string s = OGRE_HOME;
   start_input();
-  key_listener_ptr kl = key_listener_ptr(new key_listener_ptr::element_type());
-  kl->m_pressed = [&](const OIS::KeyEvent& value){return key_pressed(value);};
-  kl->m_released = [&](const OIS::KeyEvent& value){return key_released(value);};
-  set_key_listener(std::move(kl));
-  mouse_listener_ptr ml = mouse_listener_ptr(new mouse_listener_ptr::element_type());
-  ml->m_move = [&](const OIS::MouseEvent& value){return mouse_moved(value);};
-  ml->m_pressed = [&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_pressed(value, id);};
-  ml->m_released = [&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_released(value, id);};
-  set_mouse_listener(std::move(ml));
-  frame_listener_ptr fl = frame_listener_ptr(new frame_listener_ptr::element_type());
-  fl->m_started = [&](const Ogre::FrameEvent& value){return frame_startted(value);};
-  set_frame_listener(std::move(fl));
+  key_listener& kl = get_key_listener();
+  kl.m_pressed.subscribe([&](const OIS::KeyEvent& value){return key_pressed(value);});
+  kl.m_released.subscribe([&](const OIS::KeyEvent& value){return key_released(value);});
+  mouse_listener& ml = get_mouse_listener();
+  ml.m_move.subscribe([&](const OIS::MouseEvent& value){return mouse_moved(value);});
+  ml.m_pressed.subscribe([&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_pressed(value, id);});
+  ml.m_released.subscribe([&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_released(value, id);});
+  get_frame_listener().m_started.subscribe([&](const Ogre::FrameEvent& value){return frame_startted(value);});
+  get_simulation_listener().m_step.subscribe([&](const double value){return simulate(value);});
 }
 
 void tutorial4::createScene()
 {
+  TRACE_ZONE("tutorial4::createScene");
   Ogre::SceneManager* sceneManager = create_scene_manager();
   sceneManager->setAmbientLight(Ogre::ColourValue(1.0, 1.0, 1.0));
 
@@ -341,7 +68,7 @@ void tutorial4::createScene()
 
   camera->setNearClipDistance( 5 );
   
-  Ogre::Viewport* viewPort = get_render_window()->addViewport( camera );
+  Ogre::Viewport* viewPort = get_render_target()->addViewport( camera );
   viewPort->setBackgroundColour(Ogre::ColourValue(0.1, 0.1, 0.1));
   camera->setAspectRatio(Ogre::Real(viewPort->getActualWidth())/Ogre::Real(viewPort->getActualHeight()));
   camera->setProjectionType(Ogre::ProjectionType::PT_ORTHOGRAPHIC);
@@ -350,9 +77,14 @@ void tutorial4::createScene()
   Ogre::Light* light = sceneManager->createLight("MainLight");
   light->setPosition(0.0f, 0.0f, 0.120f);
 
-  sample_material();
-  createColourCube();
-  slot_machine_wheel<36>(200.0, 125.6);
+  create_colour_material("Test/ColourTest");
+  const Ogre::String render_system = Ogre::Root::getSingleton().getRenderSystem()->getName();
+  cached_mesh(mesh_key("ColourCube", "colour_cube", procedural_mesh_version).add("half_size", 100)
+    .add("render_system", render_system), [&](){ return create_colour_cube("ColourCube", 100); });
+  const unsigned int segments = 0 != get_options().m_wheel_segments ? get_options().m_wheel_segments : 36;
+  cached_mesh(mesh_key("SpotWheel", "colour_wheel", procedural_mesh_version).add("faces", segments)
+    .add("radius", 200.0).add("width", 125.6).add("render_system", render_system),
+    [&](){ return create_colour_wheel("SpotWheel", segments, 200.0, 125.6); });
   Ogre::Entity* thisEntity = sceneManager->createEntity("sw", "SpotWheel");
   thisEntity->setMaterialName("Test/ColourTest");
   Ogre::SceneNode* node = sceneManager->getRootSceneNode()->createChildSceneNode();
@@ -361,6 +93,8 @@ void tutorial4::createScene()
   //node->pitch(Ogre::Radian(1.0));
   node->attachObject(thisEntity);
   sw = node;
+  // the keys turn it, in --on-demand mode its last interpolated turn is redrawn
+  watch_node(sw);
 
   /*Ogre::Entity**/ thisEntity = sceneManager->createEntity("sw1", "SpotWheel");
   thisEntity->setMaterialName("Test/ColourTest");
@@ -370,7 +104,7 @@ void tutorial4::createScene()
   //node->pitch(Ogre::Radian(1.0));
   node->attachObject(thisEntity);
 #if 0
-  createColourCube();
+  create_colour_cube("ColourCube", 100);
   /*Ogre::Entity**/ thisEntity = sceneManager->createEntity("cc", "ColourCube");
   thisEntity->setMaterialName("Test/ColourTest");
   /*Ogre::SceneNode* */node = sceneManager->getRootSceneNode()->createChildSceneNode();
@@ -390,7 +124,6 @@ bool tutorial4::mouse_pressed(const OIS::MouseEvent& value, OIS::MouseButtonID i
 }
 
 bool tutorial4::mouse_released( const OIS::MouseEvent& value, OIS::MouseButtonID id ) {
-  //set_mouse_listener(mouse_listener_ptr());
   return true;
 }
 
@@ -443,32 +176,33 @@ bool tutorial4::key_pressed(const OIS::KeyEvent& value) {
     default:
       break;
   };
+  set_animating(0 != x || 0 != y || 0 != z);
   return true;
 }
 
 bool tutorial4::key_released(const OIS::KeyEvent& value) {
-  //set_key_listener(key_listener_ptr());
   return true;
 }
 
 bool tutorial4::frame_startted(const Ogre::FrameEvent& value) {
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-  std::chrono::system_clock::duration d = now - m_previous;
-  auto c = d.count();
-  if(c > 100000000){
-    if( (true || 0 != z || 0 != y || 0 != x) ) {
-      sw->roll(Ogre::Degree(z));
-      sw->pitch(Ogre::Degree(x));
-      sw->yaw(Ogre::Degree(y));
-    }
-    m_previous = now;
-  }
+  sw->setOrientation(Ogre::Quaternion::Slerp(interpolation_alpha(), m_previous, m_current, true));
+  return true;
+}
+
+bool tutorial4::simulate(const double step) {
+  // x, y and z are degrees per 100 ms
+  const Ogre::Real scale = 10.0 * step;
+  m_previous = m_current;
+  m_current = m_current * Ogre::Quaternion(Ogre::Degree(z * scale), Ogre::Vector3::UNIT_Z) *
+    Ogre::Quaternion(Ogre::Degree(x * scale), Ogre::Vector3::UNIT_X) *
+    Ogre::Quaternion(Ogre::Degree(y * scale), Ogre::Vector3::UNIT_Y);
+  m_current.normalise();
   return true;
 }
 
 int main(int ac, char* av[]) {
   try {
-    tutorial4 app;
+    tutorial4 app(Application::options(ac, av));
     app.startApplication();
     return 0;
   }
@@ -4,7 +4,6 @@
 #include <iostream>
 #include <exception>
 #include <type_traits>
-#include <chrono>
 
 #include <Ogre.h>
 #include <OgreRoot.h>
@@ -16,313 +15,28 @@
 #include <OISKeyboard.h>
 
 #include "application.h"
+#include "procedural_mesh.h"
+#include "reel_batch.h"
+#include "reel_strip.h"
+#include "symbol_atlas.h"
+#include "trace.h"
 
 namespace {
-  template<typename T, std::size_t N>
-  std::size_t array_size(T(&)[N]) {
-    return N;
-  }
-} /* namespace */
-
-namespace {
-
-  void create_mash(const Ogre::String& name, const Ogre::String& group, Ogre::VertexData* vd,
-      Ogre::HardwareIndexBufferSharedPtr ibuf, const Ogre::AxisAlignedBox& box, const double radius) {
-      /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual(name, group);
-    msh->sharedVertexData = vd;
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = ibuf->getNumIndexes();
-    sub->indexData->indexStart = 0;
-
-    /// Set bounding information (for culling)
-    msh->_setBounds(box);
-    msh->_setBoundingSphereRadius(radius);
-
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
-    msh->touch();
-  }
-
-  template<typename T, std::size_t N>
-  void slot_machine_faces(T(&faces)[N][2][3], const std::size_t index) {
-    if(index >= N)
-      return;
-    const T i = index * 2;
-    faces[index][0][0] = i;
-    faces[index][0][1] = i + 3;
-    faces[index][0][2] = i + 1;
-    faces[index][1][0] = i;
-    faces[index][1][1] = i + 2;
-    faces[index][1][2] = i + 3;
-  }
-
-  inline Ogre::Vector3 create_normal(const Ogre::Vector3& a, const Ogre::Vector3& b,
-      const Ogre::Vector3& c) {
-    Ogre::Vector3 res = (b - a).crossProduct(c - a);
-    res.normalise();
-    return res;
-  }
-
-  template<std::size_t face_count>
-  void apply_normal(Ogre::Vector3(&vertices)[face_count][2][2], std::size_t i) {
-    if(0 != i) {
-      const std::size_t pi = i - 1;
-      vertices[pi][0][1] = create_normal(vertices[pi][0][0], vertices[i][0][0], vertices[pi][1][0]);
-      vertices[pi][1][1] = create_normal(vertices[pi][1][0], vertices[pi][0][0], vertices[i][1][0]);
-      if(1 == face_count - i) {
-        vertices[i][0][1] = create_normal(vertices[i][0][0], vertices[0][0][0], vertices[i][1][0]);
-        vertices[i][1][1] = create_normal(vertices[i][1][0], vertices[i][0][0], vertices[0][1][0]);
-      }
-    }
-  }
 
-  template<std::size_t face_count>
-  void create_text(const std::size_t i, Ogre::Vector2(&cp)[face_count][2]) {
-    static const float step = 1.0f / (face_count - 1);
-    cp[i][0].x = 0.0f;
-    cp[i][1].y = cp[i][0].y = i * step;
-    cp[i][1].x = 1.0f;
-  }
-
-  template<std::size_t face_count, typename face_index_t = unsigned short>
-  void slot_machine_wheel_text(const float radius, const float width) {
-    static_assert(std::is_integral<face_index_t>::value && (sizeof(face_index_t) == sizeof(short) ||
-      sizeof(face_index_t) == sizeof(int)), "face_index_t must by integer and 16 or 32 bit");
-
-    const std::size_t vertice_count = face_count + 1;
-
-    const Ogre::HardwareIndexBuffer::IndexType index_type = sizeof(face_index_t) == sizeof(unsigned short) ?
-      Ogre::HardwareIndexBuffer::IT_16BIT : Ogre::HardwareIndexBuffer::IT_32BIT;
-    const float step = 2 * M_PI / face_count;
-    const float xpos = 0;
-
-    Ogre::Vector3 vertices[vertice_count][2][2];
-    Ogre::Vector2 text[vertice_count][2];
-    face_index_t faces[face_count][2][3];
-
-    double rad = -M_PI;
-    for(std::size_t i = 0; i < vertice_count; ++i) {
-      rad += step;
-      slot_machine_faces(faces, i);
-      vertices[i][0][0] = vertices[i][1][0] = Ogre::Vector3(xpos, std::sin(rad) * radius, std::cos(rad) * radius);
-      vertices[i][1][0].x += width;
-      create_text(i, text);
-      apply_normal(vertices, i);
-    }
-
-    Ogre::VertexData* vd = new Ogre::VertexData();
-    vd->vertexCount = (vertice_count) * 2;
-
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = vd->vertexDeclaration;
-    // 1st buffer
-    decl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    decl->addElement(0, sizeof(Ogre::Vector3), Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(Ogre::Vector3) * 2, vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-    vd->vertexBufferBinding->setBinding(0, vbuf);
-
-    // 2ed buffer
-    decl->addElement(1, 0, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf_text = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(Ogre::Vector2), vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    vbuf_text->writeData(0, vbuf_text->getSizeInBytes(), text, true);
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    vd->vertexBufferBinding->setBinding(1, vbuf_text);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-          createIndexBuffer(index_type, face_count * 2 * 3, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    create_mash("SpotWheelText", "General", vd, ibuf,
-      Ogre::AxisAlignedBox(0, -radius, -radius, width, radius, radius),
-      Ogre::Math::Sqrt(radius * radius + (width/2) * (width/2)));
-  }
-
-  void create_test() {
-
-    struct vertices_t {
-      Ogre::Vector3 verts;
-      Ogre::Vector3 normal;
-      Ogre::Vector2 text;
-    };
-
-    vertices_t vertices[] = {
-      { {   0.0f,   0.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } }, // 0
-      { {  50.0f,   0.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.0f } }, // 1
-      { { 100.0f,   0.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } }, // 2
-      { {   0.0f,  50.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.2f } }, // 3
-      { {  50.0f,  50.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.2f } }, // 4
-      { { 100.0f,  50.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.2f } }, // 5
-      { {   0.0f, 100.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.4f } }, // 6
-      { {  50.0f, 100.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.4f } }, // 7
-      { { 100.0f, 100.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.4f } }, // 8
-      { {   0.0f, 150.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.6f } }, // 9
-      { {  50.0f, 150.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.6f } }, // 10
-      { { 100.0f, 150.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.6f } }, // 11
-      { {   0.0f, 200.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.8f } }, // 12
-      { {  50.0f, 200.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.8f } }, // 13
-      { { 100.0f, 200.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.8f } }, // 14
-      { {   0.0f, 250.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } }, // 15
-      { {  50.0f, 250.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 0.5f, 1.0f } }, // 16
-      { { 100.0f, 250.0f, 0.0f}, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } }, // 17
-    };
-
-    unsigned short faces[20][3] = {
-      { 0, 1, 4 }, { 0, 4, 3 }, { 1, 2, 5 }, { 1, 5, 4 },
-      { 3, 4, 7 }, { 3, 7, 6 }, { 4, 5, 8 }, { 4, 8, 7 },
-      { 6, 7, 10 }, { 6, 10, 9}, { 7, 8, 11 }, { 1, 11, 10},
-      { 9, 10, 13}, { 9, 13, 12}, { 10, 11, 14 }, { 10, 14, 13 },
-      { 12, 13, 16}, { 12, 16, 15}, { 13, 14, 17}, { 13, 17, 16},
-    };
-
-    Ogre::VertexData* vd = new Ogre::VertexData();
-    vd->vertexCount = array_size(vertices);
-    Ogre::VertexDeclaration* mDecl = vd->vertexDeclaration;
-    mDecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    mDecl->addElement(0, sizeof(float) * 3, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    mDecl->addElement(0, sizeof(float) * 6, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
-    Ogre::HardwareVertexBufferSharedPtr vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(vertices_t), vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
-    vd->vertexBufferBinding->setBinding(0, vbuf);
-
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
-            Ogre::HardwareIndexBuffer::IT_16BIT, 60, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    create_mash("patch", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, vd, ibuf,
-      Ogre::AxisAlignedBox( 0.0f, 0.0f, 0.0f, 100.0f, 250.0f, 0),
-      Ogre::Math::Sqrt(50.0f * 50.0f + 125.0f * 125.0f) );
-    return;
-  }
+  // Virtual strips: stops around a reel and those kept current around the
+  // front, the arc shows half of them.
+  const std::size_t reel_stops = 16;
+  const std::size_t reel_stop_window = 10;
 
-  void create_test_new() {
-
-    Ogre::Vector3 vertices[] = {
-      {   0.0f,   0.0f, 0.0f}, // 0
-      {  50.0f,   0.0f, 0.0f}, // 1
-      { 100.0f,   0.0f, 0.0f}, // 2
-      {   0.0f,  50.0f, 0.0f}, // 3
-      {  50.0f,  50.0f, 0.0f}, // 4
-      { 100.0f,  50.0f, 0.0f}, // 5
-      {   0.0f, 100.0f, 0.0f}, // 6
-      {  50.0f, 100.0f, 0.0f}, // 7
-      { 100.0f, 100.0f, 0.0f}, // 8
-      {   0.0f, 150.0f, 0.0f}, // 9
-      {  50.0f, 150.0f, 0.0f}, // 10
-      { 100.0f, 150.0f, 0.0f}, // 11
-      {   0.0f, 200.0f, 0.0f}, // 12
-      {  50.0f, 200.0f, 0.0f}, // 13
-      { 100.0f, 200.0f, 0.0f}, // 14
-      {   0.0f, 250.0f, 0.0f}, // 15
-      {  50.0f, 250.0f, 0.0f}, // 16
-      { 100.0f, 250.0f, 0.0f}, // 17
-    };
-
-    Ogre::Vector3 normal[] = {
-      { 0.0f, 0.0f, 1.0f }, // 0
-      { 0.0f, 0.0f, 1.0f }, // 1
-      { 0.0f, 0.0f, 1.0f }, // 2
-      { 0.0f, 0.0f, 1.0f }, // 3
-      { 0.0f, 0.0f, 1.0f }, // 4
-      { 0.0f, 0.0f, 1.0f }, // 5
-      { 0.0f, 0.0f, 1.0f }, // 6
-      { 0.0f, 0.0f, 1.0f }, // 7
-      { 0.0f, 0.0f, 1.0f }, // 8
-      { 0.0f, 0.0f, 1.0f }, // 9
-      { 0.0f, 0.0f, 1.0f }, // 10
-      { 0.0f, 0.0f, 1.0f }, // 11
-      { 0.0f, 0.0f, 1.0f }, // 12
-      { 0.0f, 0.0f, 1.0f }, // 13
-      { 0.0f, 0.0f, 1.0f }, // 14
-      { 0.0f, 0.0f, 1.0f }, // 15
-      { 0.0f, 0.0f, 1.0f }, // 16
-      { 0.0f, 0.0f, 1.0f }, // 17
-    };
-
-    Ogre::Vector2 text[] = {
-      { 0.0f, 0.0f }, // 0
-      { 0.5f, 0.0f }, // 1
-      { 1.0f, 0.0f }, // 2
-      { 0.0f, 0.2f }, // 3
-      { 0.5f, 0.2f }, // 4
-      { 1.0f, 0.2f }, // 5
-      { 0.0f, 0.4f }, // 6
-      { 0.5f, 0.4f }, // 7
-      { 1.0f, 0.4f }, // 8
-      { 0.0f, 0.6f }, // 9
-      { 0.5f, 0.6f }, // 10
-      { 1.0f, 0.6f }, // 11
-      { 0.0f, 0.8f }, // 12
-      { 0.5f, 0.8f }, // 13
-      { 1.0f, 0.8f }, // 14
-      { 0.0f, 1.0f }, // 15
-      { 0.5f, 1.0f }, // 16
-      { 1.0f, 1.0f }, // 17
-    };
-
-    unsigned short faces[20][3] = {
-      { 0, 1, 4 }, { 0, 4, 3 }, { 1, 2, 5 }, { 1, 5, 4 },
-      { 3, 4, 7 }, { 3, 7, 6 }, { 4, 5, 8 }, { 4, 8, 7 },
-      { 6, 7, 10 }, { 6, 10, 9}, { 7, 8, 11 }, { 1, 11, 10},
-      { 9, 10, 13}, { 9, 13, 12}, { 10, 11, 14 }, { 10, 14, 13 },
-      { 12, 13, 16}, { 12, 16, 15}, { 13, 14, 17}, { 13, 17, 16},
-    };
-
-    Ogre::VertexData* vd = new Ogre::VertexData();
-    vd->vertexCount = array_size(vertices);
-    Ogre::VertexDeclaration* mDecl = vd->vertexDeclaration;
-    mDecl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    mDecl->addElement(1, 0, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    mDecl->addElement(2, 0, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES);
-
-    Ogre::HardwareVertexBufferSharedPtr vbuf_vertex = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(Ogre::Vector3), vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    vbuf_vertex->writeData(0, vbuf_vertex->getSizeInBytes(), vertices, true);
-
-    Ogre::HardwareVertexBufferSharedPtr vbuf_normal = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(Ogre::Vector3), vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    vbuf_normal->writeData(0, vbuf_normal->getSizeInBytes(), normal, true);
-
-    Ogre::HardwareVertexBufferSharedPtr vbuf_text = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-      sizeof(Ogre::Vector2), vd->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    vbuf_text->writeData(0, vbuf_text->getSizeInBytes(), text, true);
-
-    vd->vertexBufferBinding->setBinding(0, vbuf_vertex);
-    vd->vertexBufferBinding->setBinding(1, vbuf_normal);
-    vd->vertexBufferBinding->setBinding(2, vbuf_text);
-
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
-            Ogre::HardwareIndexBuffer::IT_16BIT, 60, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    ibuf->writeData(0, ibuf->getSizeInBytes(), faces, true);
-
-    create_mash("patch1", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, vd, ibuf,
-      Ogre::AxisAlignedBox( 0.0f, 0.0f, 0.0f, 100.0f, 250.0f, 0),
-      Ogre::Math::Sqrt(50.0f * 50.0f + 125.0f * 125.0f) );
-    return;
-  }
+  // drawing.jpeg holds this many square symbols stacked along v
+  const std::size_t strip_symbols = 10;
 
 } /* namespace */
 
 class tutorial5
     : public Application {
 public:
-  tutorial5();
+  tutorial5(const options& value);
   void createScene() override;
 private:
   bool mouse_moved(const OIS::MouseEvent& value);
@@ -331,35 +45,53 @@ private:
   bool key_pressed(const OIS::KeyEvent& value);
 	bool key_released(const OIS::KeyEvent& value);
   bool frame_startted(const Ogre::FrameEvent& value);
+  bool simulate(const double step);
+  void create_reels(Ogre::SceneManager* scene_manager, const Ogre::String& material, const Ogre::Real scale);
+  void create_symbol_atlas();
+  std::vector<Ogre::FloatRect> symbol_rects() const;
 private:
   Ogre::Camera* camera = 0;
   Ogre::SceneNode* sw = 0;
+  // --reels: spinning reels, per entity nodes or one batch
+  std::vector<Ogre::Real> m_reel_offsets;
+  // per entity either the node turned or, for arcs and ray cast proxies, the
+  // sub entity whose strip is scrolled; the other one is 0
+  std::vector<Ogre::SceneNode*> m_reel_nodes;
+  std::vector<Ogre::SubEntity*> m_reel_scrolled;
+  std::unique_ptr<reel_batch> m_reel_batch;
+  bool m_reel_arcs = false;  // the reels are arcs, set by create_reels
+  // --virtual-strip: the logical strip of every reel and their stops
+  std::vector<reel_strip> m_reel_strips;
+  std::unique_ptr<reel_strip_texture> m_reel_stops;
+  // --symbol-atlas: the symbols every reel takes its texture coordinates from
+  std::unique_ptr<symbol_atlas> m_symbols;
+  double m_spin_previous = 0.0;
+  double m_spin_current = 0.0;
   Ogre::Vector3 rotate;
-  std::chrono::system_clock::time_point m_previous;
+  Ogre::Quaternion m_previous;
+  Ogre::Quaternion m_current;
   int x = 0;
   int y = 0;
   int z = 0;
 };
 
-tutorial5::tutorial5() : Application("plugins.cfg", "resources-1.9.cfg") {
+tutorial5::tutorial5(const options& value) : Application("plugins.cfg", "resources-1.9.cfg", value) {
   const std::string s = OGRE_HOME;
   start_input();
-  key_listener_ptr kl = key_listener_ptr(new key_listener_ptr::element_type());
-  kl->m_pressed = [&](const OIS::KeyEvent& value){return key_pressed(value);};
-  kl->m_released = [&](const OIS::KeyEvent& value){return key_released(value);};
-  set_key_listener(std::move(kl));
-  mouse_listener_ptr ml = mouse_listener_ptr(new mouse_listener_ptr::element_type());
-  ml->m_move = [&](const OIS::MouseEvent& value){return mouse_moved(value);};
-  ml->m_pressed = [&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_pressed(value, id);};
-  ml->m_released = [&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_released(value, id);};
-  set_mouse_listener(std::move(ml));
-  frame_listener_ptr fl = frame_listener_ptr(new frame_listener_ptr::element_type());
-  fl->m_started = [&](const Ogre::FrameEvent& value){return frame_startted(value);};
-  set_frame_listener(std::move(fl));
+  key_listener& kl = get_key_listener();
+  kl.m_pressed.subscribe([&](const OIS::KeyEvent& value){return key_pressed(value);});
+  kl.m_released.subscribe([&](const OIS::KeyEvent& value){return key_released(value);});
+  mouse_listener& ml = get_mouse_listener();
+  ml.m_move.subscribe([&](const OIS::MouseEvent& value){return mouse_moved(value);});
+  ml.m_pressed.subscribe([&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_pressed(value, id);});
+  ml.m_released.subscribe([&](const OIS::MouseEvent& value, OIS::MouseButtonID id){return mouse_released(value, id);});
+  get_frame_listener().m_started.subscribe([&](const Ogre::FrameEvent& value){return frame_startted(value);});
+  get_simulation_listener().m_step.subscribe([&](const double value){return simulate(value);});
 }
 
 void tutorial5::createScene()
 {
+  TRACE_ZONE("tutorial5::createScene");
   Ogre::SceneManager* sceneManager = create_scene_manager();
   sceneManager->setAmbientLight(Ogre::ColourValue(1.0, 1.0, 1.0));
 
@@ -369,7 +101,7 @@ void tutorial5::createScene()
 
   camera->setNearClipDistance( 5 );
   
-  Ogre::Viewport* viewPort = get_render_window()->addViewport( camera );
+  Ogre::Viewport* viewPort = get_render_target()->addViewport( camera );
   viewPort->setBackgroundColour(Ogre::ColourValue(0.1, 0.1, 0.1));
   camera->setAspectRatio(Ogre::Real(viewPort->getActualWidth())/Ogre::Real(viewPort->getActualHeight()));
   camera->setProjectionType(Ogre::ProjectionType::PT_ORTHOGRAPHIC);
@@ -380,40 +112,89 @@ void tutorial5::createScene()
 
   Ogre::SceneNode* node;
   Ogre::Entity* ent;
-  create_test();
-  create_test_new();
-  slot_machine_wheel_text<144>(200, 125.6);
+  // packed meshes need the decoding programs and the node scale
+  const vertex_format format = get_options().m_packed_vertices ? vf_packed : vf_float;
+  const Ogre::String format_name = vf_packed == format ? "packed" : "float";
+  const Ogre::String material = vf_packed == format ? "casino/wheel1/packed" : "casino/wheel1";
+  const Ogre::Real scale = vf_packed == format ? textured_wheel_packed_scale(200, 125.6) : 1;
+  cached_mesh(mesh_key("patch", "patch", procedural_mesh_version).add("separate_sources", 0)
+    .add("format", format_name), [&](){ return create_patch("patch", false, format); });
+  cached_mesh(mesh_key("patch1", "patch", procedural_mesh_version).add("separate_sources", 1)
+    .add("format", format_name), [&](){ return create_patch("patch1", true, format); });
+  const unsigned int segments = 0 != get_options().m_wheel_segments ? get_options().m_wheel_segments : 144;
+  const Ogre::MeshPtr wheel = cached_mesh(mesh_key("SpotWheelText", "textured_wheel", procedural_mesh_version)
+    .add("faces", segments).add("radius", 200).add("width", 125.6).add("format", format_name),
+    [&](){ return create_textured_wheel("SpotWheelText", segments, 200, 125.6, format); });
+  // small reels switch to coarser levels by covered pixels
+  const std::vector<wheel_lod> levels = textured_wheel_lods("SpotWheelText", segments, 200, 125.6);
+  for(const wheel_lod& level : levels)
+    cached_mesh(mesh_key(level.m_name, "textured_wheel", procedural_mesh_version).add("faces", segments)
+      .add("level_faces", level.m_face_count).add("radius", 200).add("width", 125.6).add("format", format_name),
+      [&](){ return create_textured_wheel_level(level.m_name, segments, level.m_face_count, 200, 125.6, format); });
+  set_wheel_lods(wheel, levels, material);
+
+  // the faces of the whole wheel spent on the visible half, twice the density
+  if(get_options().m_reel_arc || 0 != get_options().m_virtual_strip)
+    cached_mesh(mesh_key("SpotReelArc", "reel_arc", procedural_mesh_version).add("faces", segments)
+      .add("arc", Ogre::Math::PI).add("radius", 200).add("width", 125.6),
+      [&](){ return create_reel_arc("SpotReelArc", segments, Ogre::Math::PI, 200, 125.6); });
+  if(!get_options().m_raycast_reels.empty())
+    cached_mesh(mesh_key("SpotReelRay", "reel_proxy", procedural_mesh_version).add("radius", 200)
+      .add("width", 125.6), [&](){ return create_reel_proxy("SpotReelRay", 200, 125.6); });
+  if(get_options().m_symbol_atlas) {
+    // every stop of the wheel shows the next symbol, one page for all reels
+    create_symbol_atlas();
+    const std::vector<Ogre::FloatRect> stops = symbol_rects();
+    const std::size_t faces_per_stop = std::max<std::size_t>(1, segments / stops.size());
+    mesh_key key("SpotSymbolWheel", "symbol_wheel", procedural_mesh_version);
+    key.add("faces_per_stop", faces_per_stop).add("radius", 200).add("width", 125.6).add("format", format_name);
+    for(const Ogre::FloatRect& stop : stops)
+      key.add("left", stop.left).add("top", stop.top).add("right", stop.right).add("bottom", stop.bottom);
+    cached_mesh(key, [&](){ return create_symbol_wheel("SpotSymbolWheel", stops, faces_per_stop, 200, 125.6, format); });
+  }
+  if(0 != get_options().m_reels || get_options().m_instanced_reels || get_options().m_reel_arc ||
+      !get_options().m_raycast_reels.empty() || 0 != get_options().m_virtual_strip || get_options().m_symbol_atlas) {
+    create_reels(sceneManager, material, scale);
+    return;
+  }
 
   ent = sceneManager->createEntity("sw4", "SpotWheelText");
-  ent->setMaterialName("casino/wheel1");
+  ent->setMaterialName(material);
   node = sceneManager->getRootSceneNode()->createChildSceneNode();
+  node->setScale(scale, scale, scale);
   node->setPosition(251.2f, 0.0f, 0.0f);
   node->attachObject(ent);
 
   ent = sceneManager->createEntity("sw0", "SpotWheelText");
-  ent->setMaterialName("casino/wheel1");
+  ent->setMaterialName(material);
   node = sceneManager->getRootSceneNode()->createChildSceneNode();
+  node->setScale(scale, scale, scale);
   node->setPosition(125.6f, 0.0f, 0.0f);
   node->attachObject(ent);
 
   ent = sceneManager->createEntity("sw1", "SpotWheelText");
-  ent->setMaterialName("casino/wheel1");
+  ent->setMaterialName(material);
   node = sceneManager->getRootSceneNode()->createChildSceneNode();
+  node->setScale(scale, scale, scale);
   node->setPosition(0.0f, 0.0f, 0.0f);
   node->attachObject(ent);
 
   ent = sceneManager->createEntity("sw2", "SpotWheelText");
-  ent->setMaterialName("casino/wheel1");
+  ent->setMaterialName(material);
   node = sceneManager->getRootSceneNode()->createChildSceneNode();
+  node->setScale(scale, scale, scale);
   node->setPosition(-125.6f, 0.0f, 0.0f);
   node->attachObject(ent);
 
   ent = sceneManager->createEntity("sw3", "SpotWheelText");
-  ent->setMaterialName("casino/wheel1");
+  ent->setMaterialName(material);
   node = sceneManager->getRootSceneNode()->createChildSceneNode();
+  node->setScale(scale, scale, scale);
   node->setPosition(-251.2f, 0.0f, 0.0f);
   node->attachObject(ent);
   sw = node;
+  // the keys turn it, in --on-demand mode its last interpolated turn is redrawn
+  watch_node(sw);
 #if 0
   // create a patch entity from the mesh, give it a material, and attach it to the origin
   ent = sceneManager->createEntity("Patch", "patch");
@@ -436,6 +217,111 @@ void tutorial5::createScene()
 #endif
 }
 
+// A bank of reels in a grid about as wide as high, never fewer than five
+// columns. Every reel shows its own part of the strip: the batch shifts the
+// strip, the entities start at the matching angle. Reel arcs show the front
+// half of a wheel and spin by scrolling the strip alone, so do ray cast
+// reels, every one of them or every other column next to tessellated ones.
+// Virtual strips are arcs too, each with a logical strip of its own. With
+// the symbol atlas the wheels are symbol wheels and every reel, batched or
+// not, samples the same atlas page.
+void tutorial5::create_reels(Ogre::SceneManager* scene_manager, const Ogre::String& material,
+    const Ogre::Real scale) {
+  TRACE_ZONE("tutorial5::create_reels");
+  const std::size_t count = 0 != get_options().m_reels ? get_options().m_reels : 5;
+  const Ogre::Real width = 125.6f;
+  const Ogre::Real height = 400.0f;
+  const std::size_t columns = std::max<std::size_t>(5, std::ceil(std::sqrt(count * height / width)));
+  const std::size_t rows = (count + columns - 1) / columns;
+  const std::size_t strip_length = get_options().m_virtual_strip;
+  const bool arc = get_options().m_reel_arc || 0 != strip_length;
+  m_reel_arcs = arc;
+  const Ogre::String& raycast = get_options().m_raycast_reels;
+  const Ogre::String mesh = arc ? "SpotReelArc" : m_symbols ? "SpotSymbolWheel" : "SpotWheelText";
+  const std::vector<Ogre::FloatRect> symbols = symbol_rects();
+  const std::size_t page = m_symbols ? m_symbols->at(0).m_page : 0;
+  sw = scene_manager->getRootSceneNode()->createChildSceneNode();
+  watch_node(sw);
+  if(get_options().m_instanced_reels) {
+    m_reel_batch.reset(new reel_batch("reels", Ogre::MeshManager::getSingleton().getByName(mesh), count));
+    m_reel_batch->setMaterial(m_symbols ? m_symbols->material(page, "casino/wheel1/instanced") :
+      "casino/wheel1/instanced");
+    sw->attachObject(m_reel_batch.get());
+  }
+  if(0 != strip_length) {
+    m_reel_stops.reset(new reel_strip_texture("reel_stops", reel_stops, count));
+    set_reel_strip_symbols("casino/wheel1/strip", symbols, m_symbols ? m_symbols->page(page) : "drawing.jpeg");
+  }
+  for(std::size_t i = 0; i < count; ++i) {
+    const Ogre::Vector3 position((Ogre::Real(i % columns) - (columns - 1) / 2.0f) * width,
+      ((rows - 1) / 2.0f - Ogre::Real(i / columns)) * height, 0.0f);
+    m_reel_offsets.push_back(std::fmod(i * 0.37f, 1.0f));
+    if(m_reel_batch) {
+      m_reel_batch->add(position, m_reel_offsets.back());
+      continue;
+    }
+    const bool ray = "all" == raycast || ("columns" == raycast && 1 == i % columns % 2);
+    Ogre::Entity* ent = scene_manager->createEntity("reel" + std::to_string(i), ray ? "SpotReelRay" : mesh);
+    ent->setMaterialName(ray ? "casino/wheel1/raycast" : 0 != strip_length ? "casino/wheel1/strip" :
+      arc ? "casino/wheel1/arc" : m_symbols ? m_symbols->material(page, material) : material);
+    if(0 != strip_length) {
+      // any of the symbols, the same strips on every run
+      std::vector<std::uint8_t> strip(strip_length);
+      std::uint32_t seed = 2166136261u ^ std::uint32_t(i);
+      for(std::uint8_t& symbol : strip) {
+        seed = seed * 1664525u + 1013904223u;
+        symbol = std::uint8_t((seed >> 16) % symbols.size());
+      }
+      m_reel_strips.emplace_back(strip, reel_stops, reel_stop_window);
+      m_reel_stops->write(i, m_reel_strips.back());
+      ent->getSubEntity(0)->setCustomParameter(1, Ogre::Vector4(reel_stops, 0, 0, 0));
+    }
+    Ogre::SceneNode* node = sw->createChildSceneNode(position);
+    node->attachObject(ent);
+    if(ray || arc) {
+      m_reel_scrolled.push_back(ent->getSubEntity(0));
+      m_reel_nodes.push_back(0);
+    }
+    else {
+      node->setScale(scale, scale, scale);
+      m_reel_scrolled.push_back(0);
+      m_reel_nodes.push_back(node);
+    }
+  }
+  if(rows > 1)
+    camera->setOrthoWindow(columns * width, rows * height);
+  set_animating(true);
+}
+
+// The symbols of drawing.jpeg cut apart again, a real game would add an
+// image file per symbol.
+void tutorial5::create_symbol_atlas() {
+  TRACE_ZONE("tutorial5::create_symbol_atlas");
+  Ogre::Image image;
+  image.load("drawing.jpeg", Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+  const std::size_t size = image.getHeight() / strip_symbols;
+  m_symbols.reset(new symbol_atlas("symbols", 512, 4));
+  for(std::size_t i = 0; i < strip_symbols; ++i)
+    m_symbols->add("symbol" + std::to_string(i), image, Ogre::Box(0, i * size, image.getWidth(), (i + 1) * size));
+  m_symbols->build();
+  for(std::size_t i = 1; i < m_symbols->size(); ++i)
+    if(m_symbols->at(i).m_page != m_symbols->at(0).m_page)
+      throw Ogre::Exception(Ogre::Exception::ERR_INVALID_STATE, "The reel symbols do not fit one page", __FILE__);
+}
+
+// Texture rectangles of the symbols in atlas order, without the atlas the
+// cells of drawing.jpeg itself.
+std::vector<Ogre::FloatRect> tutorial5::symbol_rects() const {
+  std::vector<Ogre::FloatRect> res;
+  if(m_symbols)
+    for(std::size_t i = 0; i < m_symbols->size(); ++i)
+      res.push_back(m_symbols->at(i).m_uv);
+  else
+    for(std::size_t i = 0; i < strip_symbols; ++i)
+      res.push_back(Ogre::FloatRect(0, Ogre::Real(i) / strip_symbols, 1, Ogre::Real(i + 1) / strip_symbols));
+  return res;
+}
+
 bool tutorial5::mouse_moved(const OIS::MouseEvent& value) {
   return true;
 }
@@ -445,7 +331,6 @@ bool tutorial5::mouse_pressed(const OIS::MouseEvent& value, OIS::MouseButtonID i
 }
 
 bool tutorial5::mouse_released( const OIS::MouseEvent& value, OIS::MouseButtonID id ) {
-  //set_mouse_listener(mouse_listener_ptr());
   return true;
 }
 
@@ -498,32 +383,67 @@ bool tutorial5::key_pressed(const OIS::KeyEvent& value) {
     default:
       break;
   };
+  set_animating(!m_reel_offsets.empty() || 0 != x || 0 != y || 0 != z);
   return true;
 }
 
 bool tutorial5::key_released(const OIS::KeyEvent& value) {
-  //set_key_listener(key_listener_ptr());
   return true;
 }
 
 bool tutorial5::frame_startted(const Ogre::FrameEvent& value) {
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-  std::chrono::system_clock::duration d = now - m_previous;
-  auto c = d.count();
-  if(c > 100000000){
-    if( (true || 0 != z || 0 != y || 0 != x) ) {
-      sw->roll(Ogre::Degree(z));
-      sw->pitch(Ogre::Degree(x));
-      sw->yaw(Ogre::Degree(y));
+  // touched only while the keys turn it, every change updates all reels below
+  if(m_previous != m_current)
+    sw->setOrientation(Ogre::Quaternion::Slerp(interpolation_alpha(), m_previous, m_current, true));
+  else if(sw->getOrientation() != m_current)
+    sw->setOrientation(m_current);
+  // every reel spins at one of seven speeds, arcs and ray cast reels scroll
+  // the strip as far
+  const double time = m_spin_previous + (m_spin_current - m_spin_previous) * interpolation_alpha();
+  const bool arc = m_reel_arcs;
+  for(std::size_t i = 0; i < m_reel_offsets.size(); ++i) {
+    // wrapped to one turn in double before it becomes a float, hours of
+    // spinning would otherwise quantise the angle and the strip v
+    const double turns = m_reel_offsets[i] - time * (0.5 + (i % 7) * 0.25) / Ogre::Math::TWO_PI;
+    const Ogre::Real scroll = Ogre::Real(turns - std::floor(turns));
+    const Ogre::Radian angle(Ogre::Real(m_reel_offsets[i] - scroll) * Ogre::Math::TWO_PI);
+    if(m_reel_batch && arc)
+      m_reel_batch->set_strip_offset(i, scroll);
+    else if(m_reel_batch)
+      m_reel_batch->set_angle(i, angle);
+    else if(!m_reel_strips.empty()) {
+      // the stop facing the camera is at v 0.5, a turn of the strip is a
+      // whole number of stops so the scroll wraps without a jump; the
+      // logical position keeps counting, it walks the whole strip
+      if(m_reel_strips[i].set_position((0.5 + turns) * reel_stops))
+        m_reel_stops->write(i, m_reel_strips[i]);
+      m_reel_scrolled[i]->setCustomParameter(0, Ogre::Vector4(scroll, m_reel_stops->row_coord(i), 0, 0));
     }
-    m_previous = now;
+    else if(0 != m_reel_scrolled[i])
+      m_reel_scrolled[i]->setCustomParameter(0, Ogre::Vector4(scroll, 0, 0, 0));
+    else
+      m_reel_nodes[i]->setOrientation(Ogre::Quaternion(angle - Ogre::Radian(Ogre::Math::TWO_PI * m_reel_offsets[i]),
+        Ogre::Vector3::UNIT_X));
   }
   return true;
 }
 
+bool tutorial5::simulate(const double step) {
+  // x, y and z are degrees per 100 ms
+  const Ogre::Real scale = 10.0 * step;
+  m_spin_previous = m_spin_current;
+  m_spin_current += step;
+  m_previous = m_current;
+  m_current = m_current * Ogre::Quaternion(Ogre::Degree(z * scale), Ogre::Vector3::UNIT_Z) *
+    Ogre::Quaternion(Ogre::Degree(x * scale), Ogre::Vector3::UNIT_X) *
+    Ogre::Quaternion(Ogre::Degree(y * scale), Ogre::Vector3::UNIT_Y);
+  m_current.normalise();
+  return true;
+}
+
 int main(int ac, char* av[]) {
   try {
-    tutorial5 app;
+    tutorial5 app(Application::options(ac, av));
     app.startApplication();
     return 0;
   }
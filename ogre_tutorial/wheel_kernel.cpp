@@ -0,0 +1,169 @@
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define WHEEL_KERNEL_SSE2
+#if defined(__GNUC__)
+#define WHEEL_KERNEL_AVX2
+#endif
+#endif
+
+#include "wheel_kernel.h"
+
+namespace {
+
+  // a multiple of every lane count
+  const std::size_t reseed_interval = 64;
+
+  // Returns the first ring it did not fill, rings before first are untouched.
+  std::size_t rings_scalar(const wheel_ring_params& value, const std::size_t first, const std::size_t count,
+      const wheel_ring_soa& out) {
+    const float step_cos = std::cos(value.m_step);
+    const float step_sin = std::sin(value.m_step);
+    const float offset_cos = std::cos(value.m_normal_offset) * value.m_normal_sign;
+    const float offset_sin = std::sin(value.m_normal_offset) * value.m_normal_sign;
+    float c = 0.0f;
+    float s = 0.0f;
+    for(std::size_t i = first; i < count; ++i) {
+      if(0 == (i - first) % reseed_interval) {
+        c = std::cos(value.m_start + i * value.m_step);
+        s = std::sin(value.m_start + i * value.m_step);
+      }
+      else {
+        const float next = c * step_cos - s * step_sin;
+        s = s * step_cos + c * step_sin;
+        c = next;
+      }
+      out.m_y[i] = s * value.m_radius;
+      out.m_z[i] = c * value.m_radius;
+      out.m_normal_y[i] = s * offset_cos + c * offset_sin;
+      out.m_normal_z[i] = c * offset_cos - s * offset_sin;
+      out.m_v[i] = i * value.m_v_step;
+    }
+    return count;
+  }
+
+#ifdef WHEEL_KERNEL_SSE2
+  std::size_t rings_sse2(const wheel_ring_params& value, const std::size_t count, const wheel_ring_soa& out) {
+    const std::size_t lanes = 4;
+    const __m128 step_cos = _mm_set1_ps(std::cos(value.m_step * lanes));
+    const __m128 step_sin = _mm_set1_ps(std::sin(value.m_step * lanes));
+    const __m128 offset_cos = _mm_set1_ps(std::cos(value.m_normal_offset) * value.m_normal_sign);
+    const __m128 offset_sin = _mm_set1_ps(std::sin(value.m_normal_offset) * value.m_normal_sign);
+    const __m128 radius = _mm_set1_ps(value.m_radius);
+    const __m128 v_step = _mm_set1_ps(value.m_v_step);
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 c = _mm_setzero_ps();
+    __m128 s = _mm_setzero_ps();
+    std::size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+      if(0 == i % reseed_interval) {
+        float seed_cos[lanes];
+        float seed_sin[lanes];
+        for(std::size_t k = 0; k < lanes; ++k) {
+          seed_cos[k] = std::cos(value.m_start + (i + k) * value.m_step);
+          seed_sin[k] = std::sin(value.m_start + (i + k) * value.m_step);
+        }
+        c = _mm_loadu_ps(seed_cos);
+        s = _mm_loadu_ps(seed_sin);
+      }
+      else {
+        const __m128 next = _mm_sub_ps(_mm_mul_ps(c, step_cos), _mm_mul_ps(s, step_sin));
+        s = _mm_add_ps(_mm_mul_ps(s, step_cos), _mm_mul_ps(c, step_sin));
+        c = next;
+      }
+      _mm_storeu_ps(out.m_y + i, _mm_mul_ps(s, radius));
+      _mm_storeu_ps(out.m_z + i, _mm_mul_ps(c, radius));
+      _mm_storeu_ps(out.m_normal_y + i, _mm_add_ps(_mm_mul_ps(s, offset_cos), _mm_mul_ps(c, offset_sin)));
+      _mm_storeu_ps(out.m_normal_z + i, _mm_sub_ps(_mm_mul_ps(c, offset_cos), _mm_mul_ps(s, offset_sin)));
+      _mm_storeu_ps(out.m_v + i, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(i)), lane), v_step));
+    }
+    return i;
+  }
+#endif
+
+#ifdef WHEEL_KERNEL_AVX2
+  __attribute__((target("avx2,fma")))
+  std::size_t rings_avx2(const wheel_ring_params& value, const std::size_t count, const wheel_ring_soa& out) {
+    const std::size_t lanes = 8;
+    const __m256 step_cos = _mm256_set1_ps(std::cos(value.m_step * lanes));
+    const __m256 step_sin = _mm256_set1_ps(std::sin(value.m_step * lanes));
+    const __m256 offset_cos = _mm256_set1_ps(std::cos(value.m_normal_offset) * value.m_normal_sign);
+    const __m256 offset_sin = _mm256_set1_ps(std::sin(value.m_normal_offset) * value.m_normal_sign);
+    const __m256 radius = _mm256_set1_ps(value.m_radius);
+    const __m256 v_step = _mm256_set1_ps(value.m_v_step);
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 c = _mm256_setzero_ps();
+    __m256 s = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+      if(0 == i % reseed_interval) {
+        float seed_cos[lanes];
+        float seed_sin[lanes];
+        for(std::size_t k = 0; k < lanes; ++k) {
+          seed_cos[k] = std::cos(value.m_start + (i + k) * value.m_step);
+          seed_sin[k] = std::sin(value.m_start + (i + k) * value.m_step);
+        }
+        c = _mm256_loadu_ps(seed_cos);
+        s = _mm256_loadu_ps(seed_sin);
+      }
+      else {
+        const __m256 next = _mm256_fmsub_ps(c, step_cos, _mm256_mul_ps(s, step_sin));
+        s = _mm256_fmadd_ps(s, step_cos, _mm256_mul_ps(c, step_sin));
+        c = next;
+      }
+      _mm256_storeu_ps(out.m_y + i, _mm256_mul_ps(s, radius));
+      _mm256_storeu_ps(out.m_z + i, _mm256_mul_ps(c, radius));
+      _mm256_storeu_ps(out.m_normal_y + i, _mm256_fmadd_ps(s, offset_cos, _mm256_mul_ps(c, offset_sin)));
+      _mm256_storeu_ps(out.m_normal_z + i, _mm256_fmsub_ps(c, offset_cos, _mm256_mul_ps(s, offset_sin)));
+      _mm256_storeu_ps(out.m_v + i, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(float(i)), lane), v_step));
+    }
+    return i;
+  }
+#endif
+
+  enum isa { isa_scalar, isa_sse2, isa_avx2 };
+
+  isa detect() {
+#ifdef WHEEL_KERNEL_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return isa_avx2;
+#endif
+#ifdef WHEEL_KERNEL_SSE2
+    return isa_sse2;
+#else
+    return isa_scalar;
+#endif
+  }
+
+  isa selected() {
+    static const isa res = detect();
+    return res;
+  }
+
+} /* namespace */
+
+void generate_wheel_rings(const wheel_ring_params& value, const std::size_t count, const wheel_ring_soa& out) {
+  std::size_t done = 0;
+  switch(selected()) {
+#ifdef WHEEL_KERNEL_AVX2
+    case isa_avx2:
+      done = rings_avx2(value, count, out);
+      break;
+#endif
+#ifdef WHEEL_KERNEL_SSE2
+    case isa_sse2:
+      done = rings_sse2(value, count, out);
+      break;
+#endif
+    default:
+      break;
+  }
+  rings_scalar(value, done, count, out);
+}
+
+const char* wheel_kernel_isa() {
+  static const char* const names[] = {"scalar", "sse2", "avx2"};
+  return names[selected()];
+}
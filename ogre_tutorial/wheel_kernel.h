@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+// Per ring values of a wheel around the x axis, one array entry per ring.
+class wheel_ring_soa {
+public:
+  float* m_y;
+  float* m_z;
+  float* m_normal_y;
+  float* m_normal_z;
+  float* m_v;
+};
+
+// Ring i sits at angle m_start + i * m_step, its normal at that angle plus
+// m_normal_offset, scaled by m_normal_sign. m_v is i * m_v_step.
+class wheel_ring_params {
+public:
+  double m_start;
+  double m_step;
+  double m_normal_offset;
+  float m_normal_sign;
+  float m_radius;
+  float m_v_step;
+};
+
+// Fills count rings. Sine and cosine come from rotating the previous ring by
+// the step angle, 8 rings per iteration with AVX2, 4 with SSE2 and one at a
+// time otherwise; every 64 rings are seeded exactly to bound the drift. The
+// instruction set is picked once at runtime.
+void generate_wheel_rings(const wheel_ring_params& value, const std::size_t count, const wheel_ring_soa& out);
+const char* wheel_kernel_isa();
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Unit circle and index tables of wheels with a fixed face count, evaluated by
+// the compiler. The tables are constexpr inline variables, so they end up once
+// in read only data and are shared by every process mapping the executable;
+// building such a wheel only scales the table by radius and width.
+// Ring i of a coloured wheel sits at -pi + i * step and the ring repeats
+// around, a textured wheel starts one step later and repeats its first ring
+// at the seam. Normals are those of the face following the ring, outward for
+// the coloured and towards the axis for the textured wheel.
+
+constexpr double wheel_pi = 3.14159265358979323846;
+
+// Taylor series after reducing to [-pi, pi], good to double precision there.
+constexpr double wheel_sin(double value) {
+  while(value > wheel_pi)
+    value -= 2 * wheel_pi;
+  while(value < -wheel_pi)
+    value += 2 * wheel_pi;
+  double term = value;
+  double res = value;
+  for(int i = 1; i < 24; ++i) {
+    term *= -value * value / ((2 * i) * (2 * i + 1));
+    res += term;
+  }
+  return res;
+}
+
+constexpr double wheel_cos(const double value) {
+  return wheel_sin(value + wheel_pi / 2);
+}
+
+template<std::size_t ring_count, typename index_t, std::size_t index_count>
+class wheel_table {
+public:
+  float m_sin[ring_count] = {};
+  float m_cos[ring_count] = {};
+  float m_normal_sin[ring_count] = {};
+  float m_normal_cos[ring_count] = {};
+  float m_v[ring_count] = {};
+  index_t m_indices[index_count] = {};
+};
+
+template<std::size_t face_count, bool textured>
+class wheel_layout {
+public:
+  static_assert(face_count >= 3, "a wheel needs at least 3 faces");
+  static constexpr std::size_t ring_count = textured ? face_count + 1 : face_count;
+  static constexpr std::size_t vertex_count = ring_count * 2;
+  static constexpr std::size_t index_count = face_count * 2 * 3;
+  using index_t = std::conditional_t<vertex_count <= 65536, std::uint16_t, std::uint32_t>;
+  using table_t = wheel_table<ring_count, index_t, index_count>;
+
+  static constexpr table_t create() {
+    table_t res;
+    const double step = 2 * wheel_pi / face_count;
+    const double start = textured ? -wheel_pi + step : -wheel_pi;
+    const double sign = textured ? -1.0 : 1.0;
+    for(std::size_t i = 0; i < ring_count; ++i) {
+      const double angle = start + i * step;
+      res.m_sin[i] = float(wheel_sin(angle));
+      res.m_cos[i] = float(wheel_cos(angle));
+      res.m_normal_sin[i] = float(sign * wheel_sin(angle + step / 2));
+      res.m_normal_cos[i] = float(sign * wheel_cos(angle + step / 2));
+      res.m_v[i] = textured ? float(double(i) / face_count) : 0.0f;
+    }
+    for(std::size_t i = 0; i < face_count; ++i) {
+      const std::size_t v = i * 2;
+      index_t* face = res.m_indices + i * 6;
+      face[0] = index_t(v);
+      face[1] = index_t((v + 3) % vertex_count);
+      face[2] = index_t(v + 1);
+      face[3] = index_t(v);
+      face[4] = index_t((v + 2) % vertex_count);
+      face[5] = index_t((v + 3) % vertex_count);
+    }
+    return res;
+  }
+
+  static constexpr table_t table = create();
+};